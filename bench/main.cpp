@@ -0,0 +1,235 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <QtTest>
+#include "HttpMiddleware.h"
+
+/*
+ * Per-layer cost of middleware compared to nested request handlers.
+ *
+ * Every row sends one request through a chain of pass-through layers
+ * ending with a trivial handler, the per-layer overhead of a variant
+ * is the difference between its rows divided by the number of layers.
+ */
+
+namespace {
+
+/**
+ * Handler every chain ends with.
+ */
+struct Terminal
+{
+    void operator ()(const HttpRequest &request, HttpResponse &response)
+    {
+        Q_UNUSED(request);
+        response.setStatus(HttpResponse::Ok);
+    }
+};
+
+/**
+ * Pass-through filter of a compile-time pipeline.
+ */
+struct PassFilter
+{
+    template <typename Next>
+    void operator ()(const HttpRequest &request, HttpResponse &response, Next &next)
+    {
+        next(request, response);
+    }
+};
+
+template <int Layers>
+struct Pipeline
+{
+    typedef HttpFilterLink<PassFilter, typename Pipeline<Layers - 1>::Type> Type;
+
+    static Type make()
+    {
+        return Type(PassFilter(), Pipeline<Layers - 1>::make());
+    }
+};
+
+template <>
+struct Pipeline<0>
+{
+    typedef Terminal Type;
+
+    static Type make()
+    {
+        return Terminal();
+    }
+};
+
+/**
+ * Terminal handler of a nested handlers chain.
+ */
+class TerminalHandler : public HttpRequestHandler
+{
+public:
+
+    void handleRequest(const HttpRequest &request, HttpResponse &response)
+    {
+        Terminal()(request, response);
+    }
+};
+
+/**
+ * Handler wrapping another one, the way layers are stacked
+ * without middleware.
+ */
+class PassHandler : public HttpRequestHandler
+{
+public:
+
+    explicit PassHandler(HttpRequestHandler *pNext)
+        : HttpRequestHandler(),
+          m_pNext(pNext)
+    {
+    }
+
+    void handleRequest(const HttpRequest &request, HttpResponse &response)
+    {
+        m_pNext->handleRequest(request, response);
+    }
+
+private:
+
+    HttpRequestHandler *m_pNext;
+};
+
+void passFilter(const HttpRequest &request, HttpResponse &response, HttpMiddlewareNext &next)
+{
+    next(request, response);
+}
+
+template <int Layers>
+void benchmarkPipeline()
+{
+    HttpRequest request(HttpRequest::Method_Get, "/");
+    HttpResponse response;
+    typename Pipeline<Layers>::Type pipeline = Pipeline<Layers>::make();
+
+    QBENCHMARK {
+        pipeline(request, response);
+    }
+    QCOMPARE(response.status(), HttpResponse::Ok);
+}
+
+} // anonymous namespace
+
+class BenchMiddleware : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void nestedHandlers_data() { layers(); }
+    void nestedHandlers();
+
+    void runtimeChain_data() { layers(); }
+    void runtimeChain();
+
+    void pipeline_data() { layers(); }
+    void pipeline();
+
+private:
+
+    void layers();
+};
+
+void BenchMiddleware::layers()
+{
+    QTest::addColumn<int>("layers");
+    QTest::newRow("0") << 0;
+    QTest::newRow("1") << 1;
+    QTest::newRow("2") << 2;
+    QTest::newRow("4") << 4;
+    QTest::newRow("8") << 8;
+    QTest::newRow("16") << 16;
+}
+
+void BenchMiddleware::nestedHandlers()
+{
+    QFETCH(int, layers);
+
+    TerminalHandler terminal;
+    QList<HttpRequestHandler*> handlers;
+    HttpRequestHandler *pTop = &terminal;
+    for (int i = 0; i < layers; ++i) {
+        pTop = new PassHandler(pTop);
+        handlers.append(pTop);
+    }
+
+    HttpRequest request(HttpRequest::Method_Get, "/");
+    HttpResponse response;
+    QBENCHMARK {
+        pTop->handleRequest(request, response);
+    }
+    QCOMPARE(response.status(), HttpResponse::Ok);
+
+    qDeleteAll(handlers);
+}
+
+void BenchMiddleware::runtimeChain()
+{
+    QFETCH(int, layers);
+
+    HttpMiddlewareChain chain;
+    chain.setHandler(Terminal());
+    for (int i = 0; i < layers; ++i) {
+        chain.append(passFilter);
+    }
+
+    HttpRequest request(HttpRequest::Method_Get, "/");
+    HttpResponse response;
+    QBENCHMARK {
+        chain(request, response);
+    }
+    QCOMPARE(response.status(), HttpResponse::Ok);
+}
+
+void BenchMiddleware::pipeline()
+{
+    QFETCH(int, layers);
+
+    switch (layers) {
+    case 0:
+        benchmarkPipeline<0>();
+        break;
+    case 1:
+        benchmarkPipeline<1>();
+        break;
+    case 2:
+        benchmarkPipeline<2>();
+        break;
+    case 4:
+        benchmarkPipeline<4>();
+        break;
+    case 8:
+        benchmarkPipeline<8>();
+        break;
+    case 16:
+        benchmarkPipeline<16>();
+        break;
+    default:
+        Q_ASSERT(false);
+    }
+}
+
+QTEST_APPLESS_MAIN(BenchMiddleware)
+
+#include "main.moc"
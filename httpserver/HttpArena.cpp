@@ -0,0 +1,160 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <QAtomicInteger>
+#include "HttpArena.h"
+
+static QAtomicInteger<quint64> sTotalHeapAllocations(0);
+
+HttpArena::HttpArena()
+    : m_pData(nullptr),
+      m_size(0),
+      m_capacity(0),
+      m_heapAllocations(0),
+      m_failed(false)
+{
+}
+
+HttpArena::HttpArena(const HttpArena &arena)
+    : m_pData(nullptr),
+      m_size(0),
+      m_capacity(0),
+      m_heapAllocations(0),
+      m_failed(false)
+{
+    if (arena.m_size > 0) {
+        append(arena.m_pData, arena.m_size);
+    }
+    m_failed = m_failed || arena.m_failed;
+}
+
+HttpArena& HttpArena::operator =(const HttpArena &arena)
+{
+    if (this != &arena) {
+        reset();
+        if (arena.m_size > 0) {
+            append(arena.m_pData, arena.m_size);
+        }
+        m_failed = m_failed || arena.m_failed;
+    }
+    return *this;
+}
+
+HttpArena::HttpArena(HttpArena &&arena) noexcept
+    : m_pData(arena.m_pData),
+      m_size(arena.m_size),
+      m_capacity(arena.m_capacity),
+      m_heapAllocations(arena.m_heapAllocations),
+      m_failed(arena.m_failed)
+{
+    arena.m_pData = nullptr;
+    arena.m_size = 0;
+    arena.m_capacity = 0;
+    arena.m_heapAllocations = 0;
+    arena.m_failed = false;
+}
+
+HttpArena& HttpArena::operator =(HttpArena &&arena) noexcept
+{
+    if (this != &arena) {
+        std::free(m_pData);
+        m_pData = arena.m_pData;
+        m_size = arena.m_size;
+        m_capacity = arena.m_capacity;
+        m_heapAllocations = arena.m_heapAllocations;
+        m_failed = arena.m_failed;
+        arena.m_pData = nullptr;
+        arena.m_size = 0;
+        arena.m_capacity = 0;
+        arena.m_heapAllocations = 0;
+        arena.m_failed = false;
+    }
+    return *this;
+}
+
+HttpArena::~HttpArena()
+{
+    std::free(m_pData);
+}
+
+int HttpArena::allocate(int size)
+{
+    Q_ASSERT(size >= 0);
+
+    if (qint64(m_size) + size > m_capacity && !grow(qint64(m_size) + size)) {
+        m_failed = true;
+        return -1;
+    }
+
+    int offset = m_size;
+    m_size += size;
+    return offset;
+}
+
+int HttpArena::append(const char *data, int size)
+{
+    int offset = allocate(size);
+    if (offset >= 0 && size > 0) {
+        std::memcpy(m_pData + offset, data, size);
+    }
+    return offset;
+}
+
+void HttpArena::truncate(int size)
+{
+    Q_ASSERT(size >= 0 && size <= m_size);
+    m_size = size;
+}
+
+void HttpArena::reset()
+{
+    m_size = 0;
+    m_heapAllocations = 0;
+    m_failed = false;
+}
+
+quint64 HttpArena::totalHeapAllocations()
+{
+    return sTotalHeapAllocations.load();
+}
+
+bool HttpArena::grow(qint64 size)
+{
+    if (size > MaxCapacity) {
+        // Offsets would not fit in an int
+        return false;
+    }
+
+    qint64 capacity = m_capacity > 0 ? m_capacity : qint64(MinCapacity);
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    capacity = qMin<qint64>(capacity, MaxCapacity);
+
+    char *pData = static_cast<char*>(std::realloc(m_pData, static_cast<size_t>(capacity)));
+    if (pData == nullptr) {
+        return false;
+    }
+
+    m_pData = pData;
+    m_capacity = static_cast<int>(capacity);
+    m_heapAllocations++;
+    sTotalHeapAllocations.fetchAndAddRelaxed(1);
+    return true;
+}
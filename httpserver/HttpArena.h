@@ -0,0 +1,107 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPARENA_H
+#define HTTPARENA_H
+
+#include <QtGlobal>
+#include "HttpServerApi.h"
+
+/**
+ * Bump allocator of request-scoped data.
+ *
+ * Data is carved from one growable block and referred to by offset,
+ * since the block may move when it grows. reset() discards everything
+ * at once but keeps the memory, so a connection serving keep-alive
+ * requests stops allocating once the block is large enough.
+ */
+class HTTP_API HttpArena
+{
+public:
+
+    HttpArena();
+    HttpArena(const HttpArena &arena);
+    HttpArena& operator =(const HttpArena &arena);
+    HttpArena(HttpArena &&arena) noexcept;
+    HttpArena& operator =(HttpArena &&arena) noexcept;
+    ~HttpArena();
+
+    /**
+     * Allocate a region.
+     * The arena cannot hold more than MaxCapacity bytes, past that
+     * the allocation fails and hasFailed() is set until the next reset.
+     * @param size Region size.
+     * @return Region offset, -1 on failure.
+     */
+    int allocate(int size);
+
+    /**
+     * Allocate a region and copy data into it.
+     * @return Region offset, -1 on failure.
+     */
+    int append(const char *data, int size);
+
+    /**
+     * Drop everything past the given size
+     * (e.g. unused part of the last region).
+     */
+    void truncate(int size);
+
+    char* data(int offset = 0) { return m_pData + offset; }
+    const char* constData(int offset = 0) const { return m_pData + offset; }
+
+    int size() const { return m_size; }
+    int capacity() const { return m_capacity; }
+
+    /**
+     * Discard all the regions, keeping the memory.
+     */
+    void reset();
+
+    /**
+     * Number of heap allocations made by this arena since the last reset.
+     * Zero in steady state.
+     */
+    int heapAllocations() const { return m_heapAllocations; }
+
+    /**
+     * Whether an allocation has failed since the last reset.
+     */
+    bool hasFailed() const { return m_failed; }
+
+    /**
+     * Number of heap allocations made by all arenas.
+     */
+    static quint64 totalHeapAllocations();
+
+    enum {
+        MinCapacity = 256,          ///< Initial block size.
+        MaxCapacity = 1 << 30       ///< Largest block size.
+    };
+
+private:
+
+    bool grow(qint64 size);
+
+    char *m_pData;          ///< Memory block.
+    int m_size;             ///< Used size.
+    int m_capacity;         ///< Block size.
+    int m_heapAllocations;  ///< Heap allocations since reset.
+    bool m_failed;          ///< Allocation failed since reset.
+};
+
+#endif // HTTPARENA_H
@@ -0,0 +1,182 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <cstring>
+#include "HttpArguments.h"
+
+static inline int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static inline const char* findChar(const char *p, const char *pEnd, char c)
+{
+    const char *pFound = static_cast<const char*>(std::memchr(p, c, pEnd - p));
+    return pFound != nullptr ? pFound : pEnd;
+}
+
+/**
+ * Decode percent-encoded name or value ('+' stands for a space).
+ * Escapes and '+' are located with memchr, the plain runs
+ * between them are copied at once.
+ * @return End of the decoded output.
+ */
+static char* decodeComponent(const char *p, const char *pEnd, char *pOut)
+{
+    // Next '%' and next '+', each looked up again once passed.
+    const char *pPercent = findChar(p, pEnd, '%');
+    const char *pPlus = findChar(p, pEnd, '+');
+
+    while (p < pEnd) {
+        if (pPercent < p) {
+            pPercent = findChar(p, pEnd, '%');
+        }
+        if (pPlus < p) {
+            pPlus = findChar(p, pEnd, '+');
+        }
+
+        const char *pSpecial = pPercent < pPlus ? pPercent : pPlus;
+        std::memcpy(pOut, p, pSpecial - p);
+        pOut += pSpecial - p;
+        p = pSpecial;
+
+        if (p == pEnd) {
+            break;
+        }
+
+        if (*p == '+') {
+            *pOut++ = ' ';
+            ++p;
+        } else {
+            int hi = pEnd - p >= 3 ? hexValue(p[1]) : -1;
+            int lo = hi >= 0 ? hexValue(p[2]) : -1;
+            if (lo >= 0) {
+                *pOut++ = static_cast<char>((hi << 4) | lo);
+                p += 3;
+            } else {
+                // Malformed escape is kept as is
+                *pOut++ = *p++;
+            }
+        }
+    }
+    return pOut;
+}
+
+HttpArguments::HttpArguments()
+    : HttpFieldTable(Qt::CaseSensitive)
+{
+}
+
+void HttpArguments::parse(const char *data, int size)
+{
+    if (size <= 0) {
+        return;
+    }
+
+    // Decoded data is never longer than the encoded one.
+    const int base = m_arena.allocate(size);
+    if (base < 0) {
+        return;
+    }
+    char *pBuffer = m_arena.data();
+    char *pOut = pBuffer + base;
+
+    const char *p = data;
+    const char *pEnd = data + size;
+    while (p < pEnd) {
+        const char *pPairEnd = static_cast<const char*>(std::memchr(p, '&', pEnd - p));
+        if (pPairEnd == nullptr) {
+            pPairEnd = pEnd;
+        }
+
+        if (pPairEnd > p) {
+            const char *pEq = static_cast<const char*>(std::memchr(p, '=', pPairEnd - p));
+            int nameOffset = static_cast<int>(pOut - pBuffer);
+            pOut = decodeComponent(p, pEq != nullptr ? pEq : pPairEnd, pOut);
+            int nameSize = static_cast<int>(pOut - pBuffer) - nameOffset;
+            int valueOffset = static_cast<int>(pOut - pBuffer);
+            if (pEq != nullptr) {
+                pOut = decodeComponent(pEq + 1, pPairEnd, pOut);
+            }
+            int valueSize = static_cast<int>(pOut - pBuffer) - valueOffset;
+            addEntry(nameOffset, nameSize, valueOffset, valueSize);
+        }
+
+        p = pPairEnd + 1;
+    }
+
+    m_arena.truncate(static_cast<int>(pOut - pBuffer));
+}
+
+void HttpArguments::parseCookies(const char *data, int size)
+{
+    const char *p = data;
+    const char *pEnd = data + size;
+    while (p < pEnd) {
+        const char *pPairEnd = static_cast<const char*>(std::memchr(p, ';', pEnd - p));
+        if (pPairEnd == nullptr) {
+            pPairEnd = pEnd;
+        }
+
+        const char *pEq = static_cast<const char*>(std::memchr(p, '=', pPairEnd - p));
+        if (pEq != nullptr) {
+            const char *pName = p;
+            const char *pNameEnd = pEq;
+            const char *pValue = pEq + 1;
+            const char *pValueEnd = pPairEnd;
+            while (pName < pNameEnd && (*pName == ' ' || *pName == '\t')) {
+                ++pName;
+            }
+            while (pNameEnd > pName && (pNameEnd[-1] == ' ' || pNameEnd[-1] == '\t')) {
+                --pNameEnd;
+            }
+            while (pValue < pValueEnd && (*pValue == ' ' || *pValue == '\t')) {
+                ++pValue;
+            }
+            while (pValueEnd > pValue && (pValueEnd[-1] == ' ' || pValueEnd[-1] == '\t')) {
+                --pValueEnd;
+            }
+            if (pValueEnd - pValue >= 2 && *pValue == '"' && pValueEnd[-1] == '"') {
+                ++pValue;
+                --pValueEnd;
+            }
+            if (pNameEnd > pName) {
+                add(pName, static_cast<int>(pNameEnd - pName), pValue, static_cast<int>(pValueEnd - pValue));
+            }
+        }
+
+        p = pPairEnd + 1;
+    }
+}
+
+QVariantMap HttpArguments::toVariantMap() const
+{
+    QVariantMap map;
+    for (int i = count() - 1; i >= 0; i--) {
+        map.insert(name(i), value(i));
+    }
+    return map;
+}
@@ -0,0 +1,62 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPARGUMENTS_H
+#define HTTPARGUMENTS_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVariantMap>
+#include "HttpServerApi.h"
+#include "HttpFieldTable.h"
+
+/**
+ * Request arguments (query string or url-encoded form) or cookies.
+ *
+ * Names and values are decoded in a single pass into the arena
+ * of the table (see HttpFieldTable). Names are matched exactly.
+ */
+class HTTP_API HttpArguments : public HttpFieldTable
+{
+public:
+
+    HttpArguments();
+
+    /**
+     * Parse and append url-encoded arguments
+     * (name=value pairs separated by '&').
+     * @param data Encoded arguments.
+     * @param size Data size.
+     */
+    void parse(const char *data, int size);
+    void parse(const QByteArray &data) { parse(data.constData(), data.size()); }
+
+    /**
+     * Parse and append cookies of a Cookie header
+     * (name=value pairs separated by ';', values are not decoded).
+     * @param data Cookie header value.
+     * @param size Data size.
+     */
+    void parseCookies(const char *data, int size);
+
+    /**
+     * Convert to a map (the first value of repeated names is kept).
+     */
+    QVariantMap toVariantMap() const;
+};
+
+#endif // HTTPARGUMENTS_H
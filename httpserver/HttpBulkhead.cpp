@@ -0,0 +1,149 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include "HttpOption.h"
+#include "HttpBulkhead.h"
+
+HttpBulkhead::HttpBulkhead(const QString &name, int threadCount, int maxQueued)
+    : m_name(name),
+      m_mutex(),
+      m_maxInFlight(qMax(1, threadCount)),
+      m_maxQueued(maxQueued),
+      m_inFlight(0),
+      m_queue(),
+      m_stopping(false),
+      m_retryAfter(1),
+      m_rejected(0),
+      m_completed(0),
+      m_executor(qMax(1, threadCount))
+{
+}
+
+HttpBulkhead::~HttpBulkhead()
+{
+    QQueue<Job> queue;
+    m_mutex.lock();
+    m_stopping = true;
+    queue.swap(m_queue);
+    m_mutex.unlock();
+
+    foreach (const Job &job, queue) {
+        reject(*job.exchange);
+    }
+
+    // m_executor waits for the running requests
+}
+
+int HttpBulkhead::maxInFlight() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxInFlight;
+}
+
+void HttpBulkhead::setMaxInFlight(int count)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxInFlight = qMax(1, count);
+}
+
+int HttpBulkhead::maxQueued() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxQueued;
+}
+
+void HttpBulkhead::setMaxQueued(int count)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxQueued = qMax(0, count);
+}
+
+bool HttpBulkhead::run(HttpExchange &&exchange, const HttpRequestFunction &handler)
+{
+    Q_ASSERT(!exchange.isNull());
+    Q_ASSERT(!handler.isNull());
+
+    Job job;
+    job.exchange = QSharedPointer<HttpExchange>(new HttpExchange(std::move(exchange)));
+    job.handler = handler;
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_stopping && m_inFlight < m_maxInFlight) {
+        m_inFlight++;
+        locker.unlock();
+        start(job);
+        return true;
+    }
+    if (!m_stopping && m_queue.count() < m_maxQueued) {
+        m_queue.enqueue(job);
+        return true;
+    }
+    locker.unlock();
+
+    reject(*job.exchange);
+    return false;
+}
+
+int HttpBulkhead::inFlightCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_inFlight;
+}
+
+int HttpBulkhead::queuedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_queue.count();
+}
+
+void HttpBulkhead::start(const Job &job)
+{
+    if (!m_executor.submit([this, job]() { execute(job); })) {
+        // Being destroyed
+        reject(*job.exchange);
+    }
+}
+
+void HttpBulkhead::execute(const Job &job)
+{
+    Job current = job;
+    for (;;) {
+        HttpExchange &exchange = *current.exchange;
+        if (exchange.isPending()) {
+            current.handler(exchange.request(), exchange.response());
+            exchange.finish();
+            m_completed.ref();
+        }
+        // else timed out while queued, or the client has gone
+
+        // Pass the slot on to the next request waiting
+        QMutexLocker locker(&m_mutex);
+        if (m_queue.isEmpty() || m_stopping) {
+            m_inFlight--;
+            return;
+        }
+        current = m_queue.dequeue();
+    }
+}
+
+void HttpBulkhead::reject(HttpExchange &exchange)
+{
+    m_rejected.ref();
+    exchange.response().setStatus(HttpResponse::ServiceUnavailable);
+    exchange.response().setOption(HttpOption::RetryAfter, QString::number(m_retryAfter.load()));
+    exchange.finish();
+}
@@ -0,0 +1,138 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPBULKHEAD_H
+#define HTTPBULKHEAD_H
+
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QString>
+#include "HttpServerApi.h"
+#include "HttpRequestHandler.h"
+#include "HttpExchange.h"
+#include "HttpExecutor.h"
+
+/**
+ * Isolated execution pool for request handlers.
+ *
+ * Routes assigned to a bulkhead (see HttpRouteOptions::setBulkhead())
+ * run their handlers in the bulkhead's own threads instead of the
+ * connection's thread, so a slow backend behind a route can only tie
+ * up its bulkhead. At most maxInFlight() requests are handled at once,
+ * up to maxQueued() more wait for a slot, and the rest are answered
+ * with 503 Service Unavailable right away.
+ *
+ * Handlers run on an HttpExchange: they fill in the response as usual,
+ * and the response is sent when the handler returns. Such handlers
+ * must complete the response before returning, as defer() and
+ * takeExchange() are not available to them.
+ */
+class HTTP_API HttpBulkhead
+{
+public:
+
+    /**
+     * Construct a bulkhead and start its threads.
+     * @param name Bulkhead name.
+     * @param threadCount Number of threads, also the default in-flight limit.
+     * @param maxQueued Requests allowed to wait for a thread.
+     */
+    HttpBulkhead(const QString &name, int threadCount, int maxQueued = 0);
+
+    /**
+     * Answer the requests still waiting with 503 Service Unavailable
+     * and wait for the running ones.
+     */
+    ~HttpBulkhead();
+
+    const QString& name() const { return m_name; }
+
+    int threadCount() const { return m_executor.threadCount(); }
+
+    /**
+     * Maximum number of requests handled at once.
+     * Lower than the number of threads limits the load put
+     * on a backend. This method is thread-safe.
+     */
+    int maxInFlight() const;
+    void setMaxInFlight(int count);
+
+    /**
+     * Maximum number of requests waiting for a slot.
+     * This method is thread-safe.
+     */
+    int maxQueued() const;
+    void setMaxQueued(int count);
+
+    /**
+     * Delay (in seconds) suggested to rejected clients
+     * in the Retry-After header.
+     */
+    int retryAfter() const { return m_retryAfter.load(); }
+    void setRetryAfter(int seconds) { m_retryAfter.store(seconds); }
+
+    /**
+     * Handle an exchange in the bulkhead.
+     * This method is thread-safe.
+     * @param exchange Exchange taken out of the connection.
+     * @param handler Handler to run on the exchange.
+     * @return false if the request has been rejected.
+     */
+    bool run(HttpExchange &&exchange, const HttpRequestFunction &handler);
+
+    /// Number of requests being handled.
+    int inFlightCount() const;
+
+    /// Number of requests waiting for a slot.
+    int queuedCount() const;
+
+    /// Number of requests rejected with 503.
+    quint64 rejectedCount() const { return m_rejected.load(); }
+
+    /// Number of requests handled.
+    quint64 completedCount() const { return m_completed.load(); }
+
+private:
+    Q_DISABLE_COPY(HttpBulkhead)
+
+    /// Request admitted to the bulkhead.
+    struct Job
+    {
+        QSharedPointer<HttpExchange> exchange;
+        HttpRequestFunction handler;
+    };
+
+    void start(const Job &job);
+    void execute(const Job &job);
+    void reject(HttpExchange &exchange);
+
+    QString m_name;
+    mutable QMutex m_mutex;         ///< Guards limits and the queue.
+    int m_maxInFlight;
+    int m_maxQueued;
+    int m_inFlight;                 ///< Requests being handled.
+    QQueue<Job> m_queue;            ///< Requests waiting for a slot.
+    bool m_stopping;                ///< Whether the bulkhead is being destroyed.
+    QAtomicInt m_retryAfter;        ///< Retry-After of rejections, s.
+    QAtomicInteger<quint64> m_rejected;
+    QAtomicInteger<quint64> m_completed;
+    HttpExecutor m_executor;        ///< Threads, destroyed first.
+};
+
+#endif // HTTPBULKHEAD_H
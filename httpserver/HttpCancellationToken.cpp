@@ -0,0 +1,106 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include "HttpCancellationToken.h"
+
+HttpCancellationState::HttpCancellationState()
+    : reason(HttpCancellationToken::Reason_None),
+      mutex(),
+      nextId(0),
+      callbacks()
+{
+}
+
+HttpCancellationToken::HttpCancellationToken()
+    : m_state()
+{
+}
+
+HttpCancellationToken::HttpCancellationToken(const QSharedPointer<HttpCancellationState> &state)
+    : m_state(state)
+{
+}
+
+HttpCancellationToken HttpCancellationToken::create()
+{
+    return HttpCancellationToken(QSharedPointer<HttpCancellationState>(new HttpCancellationState()));
+}
+
+HttpCancellationToken::Reason HttpCancellationToken::reason() const
+{
+    if (m_state.isNull()) {
+        return Reason_None;
+    }
+    return static_cast<Reason>(m_state->reason.load());
+}
+
+int HttpCancellationToken::subscribe(const Callback &callback)
+{
+    Q_ASSERT(!callback.isNull());
+
+    if (m_state.isNull()) {
+        return -1;
+    }
+
+    QMutexLocker locker(&m_state->mutex);
+    Reason r = static_cast<Reason>(m_state->reason.load());
+    if (r != Reason_None) {
+        // Too late, let the caller stop right away
+        locker.unlock();
+        callback(r);
+        return -1;
+    }
+
+    int id = m_state->nextId++;
+    m_state->callbacks.append(qMakePair(id, callback));
+    return id;
+}
+
+void HttpCancellationToken::unsubscribe(int id)
+{
+    if (m_state.isNull() || id < 0) {
+        return;
+    }
+
+    QMutexLocker locker(&m_state->mutex);
+    for (int i = 0; i < m_state->callbacks.count(); i++) {
+        if (m_state->callbacks.at(i).first == id) {
+            m_state->callbacks.removeAt(i);
+            return;
+        }
+    }
+}
+
+bool HttpCancellationToken::cancel(Reason reason)
+{
+    Q_ASSERT(reason != Reason_None);
+
+    if (m_state.isNull() || !m_state->reason.testAndSetOrdered(Reason_None, reason)) {
+        return false;
+    }
+
+    // Callbacks may unsubscribe, do not call them under the mutex
+    QList<QPair<int, Callback> > callbacks;
+    m_state->mutex.lock();
+    callbacks.swap(m_state->callbacks);
+    m_state->mutex.unlock();
+
+    for (int i = 0; i < callbacks.count(); i++) {
+        callbacks.at(i).second(reason);
+    }
+    return true;
+}
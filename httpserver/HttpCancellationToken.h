@@ -0,0 +1,128 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPCANCELLATIONTOKEN_H
+#define HTTPCANCELLATIONTOKEN_H
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QSharedPointer>
+#include "HttpServerApi.h"
+#include "HttpFunction.h"
+
+class HttpCancellationState;
+
+/**
+ * Cancellation signal of a request.
+ *
+ * The server cancels a request when its client disconnects or it times
+ * out, so that work nobody will read the result of can stop early.
+ * Handlers and the tasks they start (see HttpExecutor, HttpBulkhead)
+ * keep a copy of the request's token and either poll isCancelled()
+ * or subscribe() a callback.
+ *
+ * Tokens are cheap to copy; all copies share the same state.
+ * A null token is never cancelled.
+ */
+class HTTP_API HttpCancellationToken
+{
+public:
+
+    /// Why the request has been cancelled.
+    enum Reason {
+        Reason_None,            ///< Not cancelled.
+        Reason_Disconnected,    ///< The client has gone.
+        Reason_Timeout,         ///< The request or the connection has timed out.
+        Reason_Closed           ///< The server has closed the connection.
+    };
+
+    /// Function called on cancellation.
+    typedef HttpFunction<void(Reason)> Callback;
+
+    /**
+     * Construct a null token.
+     */
+    HttpCancellationToken();
+
+    /**
+     * Construct a new token, not cancelled.
+     */
+    static HttpCancellationToken create();
+
+    bool isNull() const { return m_state.isNull(); }
+
+    /**
+     * Tells whether the request has been cancelled.
+     * This method is thread-safe.
+     */
+    bool isCancelled() const { return reason() != Reason_None; }
+
+    /**
+     * Reason of the cancellation, Reason_None if not cancelled.
+     * This method is thread-safe.
+     */
+    Reason reason() const;
+
+    /**
+     * Register a function to be called on cancellation.
+     * The function is called in the thread cancelling the request
+     * (usually the connection's thread), or right away if the request
+     * is cancelled already. It should not block.
+     * This method is thread-safe.
+     * @return Subscription ID, -1 if the token is null or cancelled.
+     */
+    int subscribe(const Callback &callback);
+
+    /**
+     * Remove a function registered with subscribe().
+     * This method is thread-safe.
+     */
+    void unsubscribe(int id);
+
+    /**
+     * Cancel the request and call the subscribed functions.
+     * This method is thread-safe.
+     * @return false if the token is null or cancelled already.
+     */
+    bool cancel(Reason reason);
+
+private:
+
+    explicit HttpCancellationToken(const QSharedPointer<HttpCancellationState> &state);
+
+    QSharedPointer<HttpCancellationState> m_state;
+};
+
+/**
+ * Shared state of a cancellation token.
+ * This is an internal object shared between token copies.
+ */
+class HttpCancellationState
+{
+public:
+
+    HttpCancellationState();
+
+    QAtomicInt reason;  ///< Cancellation reason.
+    QMutex mutex;       ///< Guards the callbacks.
+    int nextId;         ///< ID of the next subscription.
+    QList<QPair<int, HttpCancellationToken::Callback> > callbacks;  ///< Subscribed functions.
+};
+
+#endif // HTTPCANCELLATIONTOKEN_H
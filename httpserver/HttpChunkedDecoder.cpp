@@ -0,0 +1,168 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <cstring>
+#include "HttpChunkedDecoder.h"
+
+HttpChunkedDecoder::HttpChunkedDecoder()
+    : m_state(State_Size),
+      m_chunkRemaining(0),
+      m_line(),
+      m_trailers()
+{
+}
+
+qint64 HttpChunkedDecoder::decode(const char *data, qint64 size, const char **ppPayload, qint64 *pPayloadSize)
+{
+    Q_ASSERT(ppPayload != nullptr);
+    Q_ASSERT(pPayloadSize != nullptr);
+
+    *ppPayload = nullptr;
+    *pPayloadSize = 0;
+
+    qint64 pos = 0;
+    while (pos < size) {
+        switch (m_state) {
+        case State_Data: {
+            qint64 n = size - pos;
+            if (n > m_chunkRemaining) {
+                n = m_chunkRemaining;
+            }
+            *ppPayload = data + pos;
+            *pPayloadSize = n;
+            m_chunkRemaining -= n;
+            if (m_chunkRemaining == 0) {
+                m_state = State_DataEnd;
+            }
+            return pos + n;
+        }
+        case State_Size:
+        case State_DataEnd:
+        case State_Trailer: {
+            const char *pStart = data + pos;
+            const char *pEol = static_cast<const char*>(std::memchr(pStart, '\n', size - pos));
+            qint64 n = pEol != nullptr ? pEol - pStart + 1 : size - pos;
+            if (m_line.size() + n > MaxLineLength) {
+                m_state = State_Error;
+                return pos;
+            }
+            m_line.append(pStart, static_cast<int>(n));
+            pos += n;
+            if (pEol == nullptr) {
+                // Wait for the rest of the line
+                return pos;
+            }
+            processLine();
+            m_line.clear();
+            break;
+        }
+        case State_Finished:
+        case State_Error:
+            // Nothing more to consume
+            return pos;
+        }
+    }
+
+    return pos;
+}
+
+void HttpChunkedDecoder::reset()
+{
+    m_state = State_Size;
+    m_chunkRemaining = 0;
+    m_line.clear();
+    m_trailers.clear();
+}
+
+void HttpChunkedDecoder::processLine()
+{
+    // Strip line terminator (bare LF is tolerated)
+    const char *p = m_line.constData();
+    const char *pEnd = p + m_line.size() - 1;
+    if (pEnd > p && *(pEnd - 1) == '\r') {
+        pEnd--;
+    }
+
+    switch (m_state) {
+    case State_Size:
+        parseSize(p, pEnd);
+        break;
+    case State_DataEnd:
+        m_state = p == pEnd ? State_Size : State_Error;
+        break;
+    case State_Trailer: {
+        if (p == pEnd) {
+            m_state = State_Finished;
+            break;
+        }
+        const char *pColon = static_cast<const char*>(std::memchr(p, ':', pEnd - p));
+        if (pColon == nullptr || pColon == p || m_trailers.count() >= MaxTrailers) {
+            m_state = State_Error;
+            break;
+        }
+        QString name = QString::fromLatin1(p, static_cast<int>(pColon - p)).trimmed();
+        QString value = QString::fromLatin1(pColon + 1, static_cast<int>(pEnd - pColon - 1)).trimmed();
+        m_trailers.append(Field(name, value));
+        break;
+    }
+    default:
+        Q_ASSERT(!"Unexpected line");
+        break;
+    }
+}
+
+void HttpChunkedDecoder::parseSize(const char *p, const char *pEnd)
+{
+    qint64 size = 0;
+    int digits = 0;
+    for (; p < pEnd; ++p, ++digits) {
+        char c = *p;
+        int value;
+        if (c >= '0' && c <= '9') {
+            value = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            value = c - 'A' + 10;
+        } else {
+            break;
+        }
+        if (digits >= 15) {
+            // Would overflow
+            m_state = State_Error;
+            return;
+        }
+        size = (size << 4) | value;
+    }
+
+    // Only whitespace or chunk extensions may follow the size
+    while (p < pEnd && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+    if (digits == 0 || (p < pEnd && *p != ';')) {
+        m_state = State_Error;
+        return;
+    }
+
+    if (size == 0) {
+        // Last chunk
+        m_state = State_Trailer;
+    } else {
+        m_chunkRemaining = size;
+        m_state = State_Data;
+    }
+}
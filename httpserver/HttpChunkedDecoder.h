@@ -0,0 +1,101 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPCHUNKEDDECODER_H
+#define HTTPCHUNKEDDECODER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include "HttpServerApi.h"
+
+/**
+ * Incremental decoder of chunked transfer coding.
+ *
+ * Input can be fed in pieces of any size. Chunk payload is not copied:
+ * decode() returns it as a pointer into the input buffer. Chunk
+ * extensions are ignored, trailer fields are collected.
+ */
+class HTTP_API HttpChunkedDecoder
+{
+public:
+
+    /// Trailer field (name, value).
+    typedef QPair<QString, QString> Field;
+
+    HttpChunkedDecoder();
+
+    /**
+     * Decode input data.
+     * Stops after the first piece of payload found, so the caller
+     * should call it repeatedly until all the input is consumed.
+     * @param data Input data.
+     * @param size Input size.
+     * @param ppPayload Set to the payload found in the input (if any).
+     * @param pPayloadSize Set to the payload size (zero if none).
+     * @return Number of input bytes consumed.
+     */
+    qint64 decode(const char *data, qint64 size, const char **ppPayload, qint64 *pPayloadSize);
+
+    /**
+     * Whether the decoder is in the middle of chunk payload.
+     * Only payload bytes are expected then, up to dataRemaining().
+     */
+    bool isReadingData() const { return m_state == State_Data; }
+    qint64 dataRemaining() const { return m_chunkRemaining; }
+
+    /// Whether the last chunk and the trailer have been decoded.
+    bool isFinished() const { return m_state == State_Finished; }
+
+    /// Whether the input is malformed.
+    bool hasError() const { return m_state == State_Error; }
+
+    /// Trailer fields received after the last chunk.
+    const QList<Field>& trailers() const { return m_trailers; }
+
+    /**
+     * Reset the decoder to decode a new body.
+     */
+    void reset();
+
+private:
+
+    enum State {
+        State_Size,         ///< Chunk size line.
+        State_Data,         ///< Chunk payload.
+        State_DataEnd,      ///< CRLF after chunk payload.
+        State_Trailer,      ///< Trailer fields.
+        State_Finished,     ///< Body is over.
+        State_Error         ///< Malformed input.
+    };
+
+    enum {
+        MaxLineLength = 8192,   ///< Longest size or trailer line.
+        MaxTrailers = 64        ///< Maximum number of trailer fields.
+    };
+
+    void processLine();
+    void parseSize(const char *p, const char *pEnd);
+
+    State m_state;
+    qint64 m_chunkRemaining;    ///< Payload left in the current chunk.
+    QByteArray m_line;          ///< Line being received.
+    QList<Field> m_trailers;    ///< Trailer fields.
+};
+
+#endif // HTTPCHUNKEDDECODER_H
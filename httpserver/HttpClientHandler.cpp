@@ -20,43 +20,89 @@
 #include <QFile>
 #include "HttpRequest.h"
 #include "HttpRequestHandler.h"
+#include "HttpDeferredResponse.h"
+#include "HttpExchange.h"
+#include "HttpServerConfig.h"
 #include "HttpOption.h"
+#include "HttpInflater.h"
+#include "HttpConnectionLimiter.h"
+#include "HttpLoadShedder.h"
+#include "HttpScheduler.h"
 #include "HttpClientHandler.h"
 
 static QMap<HttpClientHandler::State, QString> sStateToStringMap {
     {HttpClientHandler::State_Ready, "Ready"},
     {HttpClientHandler::State_ReceiveRequest, "ReceiveRequest"},
     {HttpClientHandler::State_ReceiveRequestOptions, "ReceiveRequestOptions"},
-    {HttpClientHandler::State_ReceiveRequestStringData, "ReceiveRequestStringData"},
-    {HttpClientHandler::State_ReceiveRequestBinaryData, "ReceiveRequestBinaryDaya"},
+    {HttpClientHandler::State_ReceiveRequestBinaryData, "ReceiveRequestBinaryData"},
+    {HttpClientHandler::State_ReceiveRequestChunkedData, "ReceiveRequestChunkedData"},
     {HttpClientHandler::State_ProcessRequest, "ProcessRequest"},
+    {HttpClientHandler::State_WaitProcessRequest, "WaitProcessRequest"},
     {HttpClientHandler::State_WaitFinishResponse, "WaitFinishResponse"},
     {HttpClientHandler::State_FinishResponse, "FinishResponse"},
     {HttpClientHandler::State_CloseClient, "CloseClient"}
 };
 
-HttpClientHandler::HttpClientHandler(qintptr handle, HttpRequestHandler *pRequestHandler, QObject *pParent)
+HttpClientHandler::HttpClientHandler(qintptr handle,
+                                     HttpRequestHandler *pRequestHandler,
+                                     const HttpServerConfig *pConfig,
+                                     QObject *pParent)
+    : HttpClientHandler(pRequestHandler, pConfig, pParent)
+{
+    open(handle);
+}
+
+HttpClientHandler::HttpClientHandler(HttpRequestHandler *pRequestHandler,
+                                     const HttpServerConfig *pConfig,
+                                     QObject *pParent)
     : QObject(pParent),
       m_state(State_Ready),
       m_pSocket(nullptr),
+      m_connectionId(-1),
+      m_generation(0),
+      m_closing(false),
+      m_pLimiter(nullptr),
+      m_peerAddress(),
+      m_addressAcquired(false),
       m_keepAlive(false),
       m_request(),
       m_response(),
       m_contentReceived(0L),
       m_contentLength(0L),
-      m_pRequestHandler(pRequestHandler)
+      m_chunkedDecoder(),
+      m_multipartParser(),
+      m_multipart(false),
+      m_pInflater(nullptr),
+      m_headerSize(0),
+      m_receivedTime(-1),
+      m_readyTime(0),
+      m_priority(HttpRequest::Priority_Normal),
+      m_pScheduler(nullptr),
+      m_scheduledPriority(HttpRequest::Priority_Normal),
+      m_pPrevScheduled(nullptr),
+      m_pNextScheduled(nullptr),
+      m_pRequestHandler(pRequestHandler),
+      m_pConfig(pConfig),
+      m_deferred(),
+      m_cancellation(),
+      m_timeout(),
+      m_timeoutKind(Timeout_None)
 {
-    m_pSocket = new QTcpSocket(this);
-    m_pSocket->setSocketDescriptor(handle);
+    Q_ASSERT(pConfig != nullptr);
 
-    m_keepAlive = false;
+    m_pSocket = new QTcpSocket(this);
 
-    connect(m_pSocket, SIGNAL(disconnected()), this, SLOT(onDisconnect()));
-    connect(m_pSocket, SIGNAL(readyRead()), this, SLOT(onDataAvailable()));
+    m_timeout.setCallback([this]() {
+        onTimeout();
+    });
 }
 
 HttpClientHandler::~HttpClientHandler()
 {
+    unschedule();
+    detachDeferredResponse();
+    releaseInflater();
+
     // Socket is supposed to be closed here.
     // Disconnect all signals from socket.
     disconnect(m_pSocket, 0, this, 0);
@@ -65,45 +111,212 @@ HttpClientHandler::~HttpClientHandler()
 
 void HttpClientHandler::finalizeResponse()
 {
-    Q_ASSERT(m_state == State_WaitFinishResponse);
-
+    // The response may have been already finalized on timeout.
     if (m_state == State_WaitFinishResponse) {
+        stopTimeout();
         setState(State_FinishResponse, true);
     }
 }
 
+HttpDeferredResponse HttpClientHandler::deferResponse()
+{
+    Q_ASSERT(m_state == State_WaitFinishResponse);
+
+    if (m_state != State_WaitFinishResponse) {
+        return HttpDeferredResponse();
+    }
+
+    if (m_deferred.isNull()) {
+        m_deferred = QSharedPointer<HttpDeferredResponseState>(new HttpDeferredResponseState(this));
+    }
+
+    return HttpDeferredResponse(m_deferred);
+}
+
+HttpExchange HttpClientHandler::takeExchange()
+{
+    if (!m_request.isValid()) {
+        // Taken already
+        return HttpExchange();
+    }
+
+    HttpDeferredResponse deferred = deferResponse();
+    if (deferred.isNull()) {
+        return HttpExchange();
+    }
+
+    int timeout = m_response.timeout();
+    m_cancellation = m_request.cancellation();
+    HttpExchange exchange(std::move(m_request), std::move(m_response), deferred);
+
+    // Keep a response to answer with on timeout
+    m_request.reset();
+    m_response = HttpResponse(this);
+    m_response.setSocket(m_pSocket);
+    m_keepAlive = false;
+    m_response.setVersion(exchange.request().majorVersion(), exchange.request().minorVersion());
+    m_response.setTimeout(timeout);
+
+    return exchange;
+}
+
+void HttpClientHandler::open(qintptr handle)
+{
+    // Handlers are only reused once the socket is disconnected
+    Q_ASSERT(m_pSocket->state() == QAbstractSocket::UnconnectedState);
+    Q_ASSERT(!m_closing);
+
+    // Reset what is left from the previous connection
+    m_generation++;
+    m_state = State_Ready;
+    m_keepAlive = false;
+    m_request.reset();
+    m_response = HttpResponse(this);
+    m_contentReceived = 0L;
+    m_headerSize = 0;
+    m_contentLength = 0L;
+    m_chunkedDecoder.reset();
+    m_multipartParser.reset(QByteArray());
+    m_multipart = false;
+
+    m_pSocket->setSocketDescriptor(handle);
+
+    if (m_pLimiter != nullptr) {
+        m_peerAddress = m_pSocket->peerAddress();
+        m_addressAcquired = m_pLimiter->acquire(m_peerAddress);
+        if (!m_addressAcquired) {
+            // Too many connections from this client
+            m_pLimiter->addRejected();
+            m_pSocket->write(m_pLimiter->rejection());
+            close();
+            return;
+        }
+    }
+
+    connect(m_pSocket, SIGNAL(disconnected()), this, SLOT(onDisconnect()));
+    connect(m_pSocket, SIGNAL(readyRead()), this, SLOT(onDataAvailable()));
+    connect(m_pSocket, SIGNAL(bytesWritten(qint64)), this, SLOT(onBytesWritten()));
+
+    startTimeout(Timeout_Header, m_pConfig->headerTimeout());
+}
+
 void HttpClientHandler::close()
 {
+    if (!m_pSocket->isOpen()) {
+        // Closed already, the handler may be reused by now.
+        return;
+    }
+
+    stopTimeout();
+    unschedule();
+    if (m_state != State_CloseClient) {
+        // Closed in the middle of a request
+        cancelRequest(HttpCancellationToken::Reason_Closed);
+    }
+    detachDeferredResponse();
+    releaseInflater();
+
+    if (m_addressAcquired) {
+        m_pLimiter->release(m_peerAddress);
+        m_addressAcquired = false;
+    }
+
     // Disconnect signals from socket to avoid
     // duplications.
     disconnect(m_pSocket, 0, this, 0);
     m_pSocket->close();
+
+    if (m_pSocket->state() == QAbstractSocket::UnconnectedState) {
+        emit over(this);
+        return;
+    }
+
+    // The socket is still sending the response: the handler must not
+    // be reused (and its socket reopened) until it is done.
+    m_closing = true;
+    connect(m_pSocket, SIGNAL(disconnected()), this, SLOT(onClosed()));
+    startTimeout(Timeout_Linger, m_pConfig->writeTimeout());
+}
+
+void HttpClientHandler::onClosed()
+{
+    if (!m_closing) {
+        return;
+    }
+
+    m_closing = false;
+    stopTimeout();
+    disconnect(m_pSocket, 0, this, 0);
     emit over(this);
 }
 
 void HttpClientHandler::onDisconnect()
 {
+    // Let the handler stop working on the response
+    cancelRequest(HttpCancellationToken::Reason_Disconnected);
     close();
 }
 
 void HttpClientHandler::onDataAvailable()
 {
+    if (m_timeoutKind == Timeout_KeepAlive) {
+        // A new request starts
+        startTimeout(Timeout_Header, m_pConfig->headerTimeout());
+    } else if (m_timeoutKind == Timeout_Body) {
+        startTimeout(Timeout_Body, m_pConfig->bodyTimeout());
+    }
+
     while (m_pSocket->bytesAvailable() > 0) {
+        if (m_state == State_WaitProcessRequest || m_state == State_WaitFinishResponse) {
+            // Pipelined requests wait for the current one
+            break;
+        }
         handleState();
     }
 }
 
+void HttpClientHandler::onBytesWritten()
+{
+    if (m_timeoutKind != Timeout_Write) {
+        return;
+    }
+
+    if (m_pSocket->bytesToWrite() > 0) {
+        startTimeout(Timeout_Write, m_pConfig->writeTimeout());
+    } else {
+        startIdleTimeout();
+    }
+}
+
 void HttpClientHandler::receiveRequest()
 {
-    if (!m_pSocket->canReadLine()) {
+    bool lineReceived = m_pSocket->canReadLine();
+    if (!lineReceived && !isHeaderTooLarge(m_pSocket->bytesAvailable())) {
         // Wait for more data
         return;
     }
 
-    m_request = HttpRequest();
+    m_request.reset();
     m_response = HttpResponse(this);
+    m_response.setSocket(m_pSocket);
+    m_priority = HttpRequest::Priority_Normal;
+    m_headerSize = 0;
+    m_receivedTime = -1;
 
-    QString strRequest = m_pSocket->readLine();
+    if (!lineReceived) {
+        // No end of the request line in sight
+        rejectRequest(HttpResponse::RequestUriTooLarge);
+        return;
+    }
+
+    QByteArray line = m_pSocket->readLine();
+    m_headerSize = line.size();
+    if (isHeaderTooLarge(m_headerSize)) {
+        rejectRequest(HttpResponse::RequestUriTooLarge);
+        return;
+    }
+
+    QString strRequest = line;
     QStringList reqList = strRequest.split(" ", QString::SkipEmptyParts);
     if (reqList.count() < 3) {
         // Request is formed incorrectly
@@ -117,17 +330,14 @@ void HttpClientHandler::receiveRequest()
         return;
     }
 
-    // Parse URI
-    QByteArray ba = QByteArray::fromPercentEncoding(reqList.at(1).toUtf8());
-    QString uri(ba);
-
-    // Parse URI arguments
-    QStringList urlArgs = uri.split("?", QString::SkipEmptyParts);
-    if (urlArgs.count() > 1) {
-        uri = urlArgs.at(0);
-        QString strArgs = urlArgs.at(1);
-        m_request.parseArguments(strArgs);
+    // Split the query before decoding, it may contain encoded '?'
+    QByteArray target = reqList.at(1).toUtf8();
+    int queryPos = target.indexOf('?');
+    if (queryPos >= 0) {
+        m_request.parseArguments(target.mid(queryPos + 1));
+        target.truncate(queryPos);
     }
+    QString uri = QString::fromUtf8(QByteArray::fromPercentEncoding(target));
 
     // Parse HTTP version
     QString httpVersion = reqList.at(2);
@@ -150,6 +360,7 @@ void HttpClientHandler::receiveRequest()
     m_request.setUri(uri);
     m_request.setMajorVersion(major);
     m_request.setMinorVersion(minor);
+    m_response.setVersion(major, minor);
 
 #ifdef _DEBUG
     qDebug() << m_request.toString();
@@ -162,10 +373,21 @@ void HttpClientHandler::receiveRequest()
 void HttpClientHandler::receiveOptions()
 {
     while (m_pSocket->canReadLine()) {
-        QString line = m_pSocket->readLine();
+        QByteArray line = m_pSocket->readLine();
+        m_headerSize += line.size();
+        if (isHeaderTooLarge(m_headerSize)) {
+            rejectRequest(HttpResponse::RequestHeaderFieldsTooLarge);
+            return;
+        }
         if (line.trimmed().isEmpty()) {
             // Empty line received
+            m_receivedTime = HttpScheduler::instance()->now();
+
+            // The request may be moved out by the handler, check for keep-alive now.
+            m_keepAlive = m_request.option(HttpOption::Connection).toString().toLower() == "keep-alive";
+
             bool ok = false;
+            bool chunked = false;
             m_contentReceived = 0L;
             m_contentLength = m_request.option(HttpOption::ContentLength).toLongLong(&ok);
             if (!ok) {
@@ -173,62 +395,101 @@ void HttpClientHandler::receiveOptions()
                 m_contentLength = -1L;
             }
 
-            if (m_contentLength > 0) {
+            QString contentType = m_request.option(HttpOption::ContentType).toString();
+            if (!contentType.isEmpty()) {
+                m_request.setContentType(HttpContentType(contentType));
+            }
+
+            QString transferEncoding = m_request.option(HttpOption::TransferEncoding).toString().trimmed().toLower();
+            if (!transferEncoding.isEmpty()) {
+                // Transfer coding overrides the content length
+                m_contentLength = -1L;
+                if (transferEncoding != "chunked") {
+                    // Either no chunked coding, so the body length
+                    // is unknown, or other codings are applied on top.
+                    rejectRequest(transferEncoding.endsWith("chunked") ? HttpResponse::NotImplemented
+                                                                      : HttpResponse::BadRequest);
+                    return;
+                }
+                chunked = true;
+            }
+
+            HttpInflater::Encoding encoding = HttpInflater::encodingFromString(
+                        m_request.option(HttpOption::ContentEncoding).toString());
+            if (encoding == HttpInflater::Encoding_Unknown) {
+                rejectRequest(HttpResponse::UnsupportedMediaType);
+                return;
+            }
+
+            if (!admitRequest(chunked || m_contentLength > 0)) {
+                return;
+            }
+
+            releaseInflater();
+            if (encoding != HttpInflater::Encoding_Identity && (chunked || m_contentLength > 0)) {
+                // Handlers see the decompressed body.
+                m_pInflater = HttpInflater::acquire(encoding);
+                if (m_pInflater == nullptr) {
+                    rejectRequest(HttpResponse::InternalServerError);
+                    return;
+                }
+            }
+
+            if (chunked) {
+                m_chunkedDecoder.reset();
+                setState(State_ReceiveRequestChunkedData, true);
+            } else if (m_contentLength > 0) {
                 setState(State_ReceiveRequestBinaryData, true);
             } else {
-                if (m_request.method() == HttpRequest::Method_Get) {
-                    // No data to receive
-                    setState(State_ProcessRequest, true);
-                } else {
-                    setState(State_ReceiveRequestStringData, true);
-                }
+                // Neither length nor chunked coding: no body.
+                setState(State_ProcessRequest, true);
+            }
+            if (m_state != State_ProcessRequest) {
+                startTimeout(Timeout_Body, m_pConfig->bodyTimeout());
             }
+            // What follows is the body
+            return;
         } else {
-            // Check for options
-            int pos = line.indexOf(":");
+            // Header fields are stored as received,
+            // cookies are parsed on demand.
+            int pos = line.indexOf(':');
             if (pos > 0) {
-                QString key = line.left(pos).trimmed();
-                QString value = line.mid(pos + 1).trimmed();
-                if (key.toLower() == "cookie") {
-                    // This option is a cookie
-                    QStringList lstCookies = value.split(";", QString::SkipEmptyParts);
-                    foreach (const QString &str, lstCookies) {
-                        m_request.parseCookie(str);
-                    }
-                } else {
-                    // Not a cookie
-                    m_request.addOption(key, value);
+                m_request.addHeader(line.constData(), pos,
+                                    line.constData() + pos + 1, line.size() - pos - 1);
+                if (m_request.headers().hasOverflowed()) {
+                    rejectRequest(HttpResponse::RequestHeaderFieldsTooLarge);
+                    return;
                 }
             }
         }
     }
-}
 
-void HttpClientHandler::receiveStringData()
-{
-    while (m_pSocket->canReadLine()) {
-        QString line = m_pSocket->readLine();
-        if (line.trimmed().isEmpty()) {
-            // Data is over
-            setState(State_ProcessRequest, true);
-            return;
-        }
-
-        m_request.appendData(line.toLatin1());
+    if (isHeaderTooLarge(m_headerSize + m_pSocket->bytesAvailable())) {
+        // No end of the header line in sight
+        rejectRequest(HttpResponse::RequestHeaderFieldsTooLarge);
     }
 }
 
 void HttpClientHandler::receiveBinaryData()
 {
+    char buffer[16384];
     qint64 available;
     while ((available = m_pSocket->bytesAvailable()) > 0) {
         qint64 toRead = m_contentLength - m_contentReceived;
         if (toRead > available) {
             toRead = available;
         }
-        QByteArray ba = m_pSocket->read(toRead);
-        m_request.appendData(ba);
-        m_contentReceived += toRead;
+        if (toRead > qint64(sizeof(buffer))) {
+            toRead = sizeof(buffer);
+        }
+        qint64 size = m_pSocket->read(buffer, toRead);
+        if (size <= 0) {
+            return;
+        }
+        if (!appendBody(buffer, size)) {
+            return;
+        }
+        m_contentReceived += size;
         if (m_contentReceived >= m_contentLength) {
             // All data received
             setState(State_ProcessRequest, true);
@@ -237,24 +498,111 @@ void HttpClientHandler::receiveBinaryData()
     }
 }
 
+void HttpClientHandler::receiveChunkedData()
+{
+    char buffer[16384];
+    for (;;) {
+        // Never read past the end of the body, so that the next
+        // pipelined request remains in the socket.
+        qint64 size;
+        if (m_chunkedDecoder.isReadingData()) {
+            qint64 toRead = m_chunkedDecoder.dataRemaining();
+            if (toRead > qint64(sizeof(buffer))) {
+                toRead = sizeof(buffer);
+            }
+            size = m_pSocket->read(buffer, toRead);
+        } else {
+            size = m_pSocket->readLine(buffer, sizeof(buffer));
+        }
+        if (size <= 0) {
+            // Wait for more data
+            return;
+        }
+        m_contentReceived += size;
+
+        qint64 pos = 0;
+        while (pos < size) {
+            const char *pPayload = nullptr;
+            qint64 payloadSize = 0;
+            pos += m_chunkedDecoder.decode(buffer + pos, size - pos, &pPayload, &payloadSize);
+
+            if (payloadSize > 0 && !appendBody(pPayload, payloadSize)) {
+                return;
+            }
+
+            if (m_chunkedDecoder.hasError()) {
+                rejectRequest(HttpResponse::BadRequest);
+                return;
+            }
+
+            if (m_chunkedDecoder.isFinished()) {
+                foreach (const HttpChunkedDecoder::Field &field, m_chunkedDecoder.trailers()) {
+                    m_request.addOption(field.first, field.second);
+                }
+                setState(State_ProcessRequest, true);
+                return;
+            }
+        }
+    }
+}
+
 void HttpClientHandler::processRequest()
 {
+    stopTimeout();
+
     if (m_request.isValid()) {
-        m_response.setVersion(m_request.majorVersion(), m_request.minorVersion());
-        m_response.setSocket(m_pSocket);
+        // The body is complete
+        m_request.body().setConsumer(HttpRequestBody::Consumer());
+
+        if (m_pInflater != nullptr) {
+            bool truncated = !m_pInflater->isFinished();
+            releaseInflater();
+            if (truncated) {
+                rejectRequest(HttpResponse::BadRequest);
+                return;
+            }
+        }
+
+        if (m_multipart) {
+            m_multipart = false;
+            if (!m_multipartParser.isFinished()) {
+                m_multipartParser.reset(QByteArray());
+                rejectRequest(HttpResponse::BadRequest);
+                return;
+            }
+            foreach (const HttpMultipartPart &part, m_multipartParser.parts()) {
+                m_request.addPart(part);
+                if (!part.isFile() && !part.body().isSpilled()) {
+                    QByteArray name = part.name().toUtf8();
+                    const QByteArray &value = part.body().data();
+                    m_request.arguments().add(name.constData(), name.size(), value.constData(), value.size());
+                    if (m_request.arguments().hasOverflowed()) {
+                        m_multipartParser.reset(QByteArray());
+                        rejectRequest(HttpResponse::RequestEntryTooLarge);
+                        return;
+                    }
+                }
+            }
+            m_multipartParser.reset(QByteArray());
+        }
 
         if (m_request.contentType() == HttpContentType::ApplicationFromUrlEncoded) {
-            QString strData = QString(m_request.constData());
-            m_request.parseArguments(strData);
+            // Chunked or compressed forms are only known to be too large now
+            if (isFormTooLarge(m_request.body().size())) {
+                rejectRequest(HttpResponse::RequestEntryTooLarge);
+                return;
+            }
+            m_request.parseArguments(m_request.body().readAll());
             m_request.setData(QByteArray());
         }
 
         if (m_pRequestHandler != nullptr) {
-            /* The state is set to 'waiting for response finalization' so that
-             * the handler could finalize the response once it is ready.
-             */
-            setState(State_WaitFinishResponse);
-            m_pRequestHandler->processRequest(m_request, m_response);
+            // Wait for our turn among the requests ready on this thread
+            m_priority = m_request.priority();
+            setState(State_WaitProcessRequest);
+            m_pScheduler = HttpScheduler::instance();
+            m_readyTime = m_pScheduler->now();
+            m_pScheduler->schedule(this, m_priority);
             return;
         } else {
             m_response.setStatus(HttpResponse::NotFound);
@@ -267,12 +615,71 @@ void HttpClientHandler::processRequest()
     setState(State_FinishResponse, true);
 }
 
+void HttpClientHandler::dispatchRequest()
+{
+    m_pScheduler = nullptr;
+    if (m_state != State_WaitProcessRequest) {
+        return;
+    }
+
+    int sheddingTarget = m_pConfig->sheddingTarget();
+    if (sheddingTarget > 0) {
+        // Queueing delay is the wait in the scheduler
+        bool sheddable = m_request.isSheddable() && m_priority != HttpRequest::Priority_Critical;
+        if (!HttpLoadShedder::instance()->admit(HttpScheduler::instance()->now() - m_readyTime, sheddingTarget,
+                                                m_pConfig->sheddingInterval(), sheddable, m_priority)) {
+            // Overloaded, answer right away
+            HttpScheduler::addShed(m_priority);
+            m_response.setStatus(HttpResponse::ServiceUnavailable);
+            m_response.setOption(HttpOption::RetryAfter, QString::number(m_pConfig->retryAfter()));
+            setState(State_FinishResponse, true);
+            return;
+        }
+    }
+
+    /* The state is set to 'waiting for response finalization' so that
+     * the handler could finalize the response once it is ready.
+     */
+    setState(State_WaitFinishResponse);
+    m_pRequestHandler->processRequest(m_request, m_response);
+
+    if (m_state == State_WaitFinishResponse) {
+        // Response is not finalized yet, limit the waiting time.
+        int timeout = m_response.timeout();
+        if (timeout < 0) {
+            timeout = m_pConfig->responseTimeout();
+        }
+        if (timeout > 0) {
+            startTimeout(Timeout_Response, timeout);
+        }
+    }
+}
+
+void HttpClientHandler::cancelRequest(HttpCancellationToken::Reason reason)
+{
+    m_request.cancel(reason);
+    m_cancellation.cancel(reason);
+    m_cancellation = HttpCancellationToken();
+}
+
+void HttpClientHandler::unschedule()
+{
+    if (m_pScheduler != nullptr) {
+        m_pScheduler->cancel(this);
+        m_pScheduler = nullptr;
+    }
+}
+
 void HttpClientHandler::waitFinishResponse()
 {
 }
 
 void HttpClientHandler::finishResponse()
 {
+    stopTimeout();
+    detachDeferredResponse();
+    m_cancellation = HttpCancellationToken();
+
 #ifdef _DEBUG
     qDebug() << m_response.status() << HttpResponse::statusToString(m_response.status());
 #endif
@@ -310,18 +717,20 @@ void HttpClientHandler::finishResponse()
     if (!m_response.isSent()) {
         m_response.send();
     }
+    if (m_receivedTime >= 0) {
+        HttpScheduler::addLatency(m_priority, HttpScheduler::instance()->now() - m_receivedTime);
+    }
 
     // Check for keep-alive option
-    m_keepAlive = false;
-    QString kaStr = m_request.option(HttpOption::Connection).toString().toLower();
-    if (kaStr == "keep-alive") {
+    if (m_keepAlive) {
         m_keepAlive = (m_response.option(HttpOption::Connection).toString().toLower() != "close");
     }
 
     if (isKeepAlive()) {
-        m_request = HttpRequest();
+        m_request.reset();
         m_response = HttpResponse();
         setState(State_ReceiveRequest, true);
+        startIdleTimeout();
     } else {
         setState(State_CloseClient, true);
     }
@@ -345,15 +754,20 @@ void HttpClientHandler::handleState()
     case State_ReceiveRequestOptions:
         receiveOptions();
         break;
-    case State_ReceiveRequestStringData:
-        receiveStringData();
-        break;
     case State_ReceiveRequestBinaryData:
         receiveBinaryData();
         break;
+    case State_ReceiveRequestChunkedData:
+        receiveChunkedData();
+        break;
     case State_ProcessRequest:
         processRequest();
         break;
+    case State_WaitProcessRequest:
+        break;
+    case State_WaitFinishResponse:
+        waitFinishResponse();
+        break;
     case State_FinishResponse:
         finishResponse();
         break;
@@ -368,7 +782,341 @@ void HttpClientHandler::handleState()
 
 void HttpClientHandler::handleStateAsync()
 {
-    QMetaObject::invokeMethod(this, "handleState");
+    QMetaObject::invokeMethod(this, "onStateUpdate", Q_ARG(int, m_generation));
+}
+
+void HttpClientHandler::onStateUpdate(int generation)
+{
+    if (generation == m_generation && !m_closing && m_pSocket->isOpen()) {
+        handleState();
+    }
+}
+
+void HttpClientHandler::onDeferredResponseResolved()
+{
+    if (m_deferred.isNull()) {
+        // Stale notification
+        return;
+    }
+
+    HttpResponseResolver resolver;
+    {
+        QMutexLocker locker(&m_deferred->mutex);
+        if (m_deferred->pending) {
+            // Stale notification of a previous deferred response
+            return;
+        }
+        resolver = m_deferred->resolver;
+    }
+    detachDeferredResponse();
+
+    if (m_state == State_WaitFinishResponse) {
+        resolver(m_response);
+        finalizeResponse();
+    }
+}
+
+void HttpClientHandler::onResponseTimeout()
+{
+    if (m_state != State_WaitFinishResponse) {
+        return;
+    }
+
+    HttpResponse::Status status = HttpResponse::ServiceUnavailable;
+    if (!m_deferred.isNull()) {
+        QMutexLocker locker(&m_deferred->mutex);
+        if (!m_deferred->pending) {
+            // Resolved already, the completion is on its way.
+            return;
+        }
+        // Waiting for a backend
+        status = HttpResponse::GatewayTimeout;
+    }
+    detachDeferredResponse();
+    cancelRequest(HttpCancellationToken::Reason_Timeout);
+
+    if (m_response.isSent()) {
+        // Response is being streamed, nothing to fix up.
+        setState(State_CloseClient, true);
+        return;
+    }
+
+    m_response.setStatus(status);
+    m_response.setData(QByteArray());
+    m_response.setOption(HttpOption::Connection, "Close");
+    finalizeResponse();
+}
+
+void HttpClientHandler::startTimeout(Timeout timeout, int ms)
+{
+    if (ms > 0) {
+        m_timeoutKind = timeout;
+        m_timeout.start(ms);
+    } else {
+        stopTimeout();
+    }
+}
+
+void HttpClientHandler::stopTimeout()
+{
+    m_timeoutKind = Timeout_None;
+    m_timeout.cancel();
+}
+
+void HttpClientHandler::startIdleTimeout()
+{
+    if (m_pSocket->bytesToWrite() > 0) {
+        // The client is still to read the response
+        startTimeout(Timeout_Write, m_pConfig->writeTimeout());
+    } else if (m_state == State_ReceiveRequest) {
+        startTimeout(Timeout_KeepAlive, m_pConfig->keepAliveTimeout());
+    } else {
+        stopTimeout();
+    }
+}
+
+void HttpClientHandler::onTimeout()
+{
+    Timeout timeout = m_timeoutKind;
+    m_timeoutKind = Timeout_None;
+
+    switch (timeout) {
+    case Timeout_Response:
+        onResponseTimeout();
+        break;
+    case Timeout_Write:
+        // Do not wait for the output to be flushed
+        cancelRequest(HttpCancellationToken::Reason_Timeout);
+        close();
+        m_pSocket->abort();
+        onClosed();
+        break;
+    case Timeout_Linger:
+        // The client does not read the end of the response
+        m_pSocket->abort();
+        onClosed();
+        break;
+    case Timeout_Header:
+    case Timeout_Body:
+    case Timeout_KeepAlive:
+        cancelRequest(HttpCancellationToken::Reason_Timeout);
+        close();
+        break;
+    default:
+        break;
+    }
+}
+
+bool HttpClientHandler::admitRequest(bool hasBody)
+{
+    qint64 maxBodySize = m_pConfig->maxBodySize();
+    if (maxBodySize > 0 && m_contentLength > maxBodySize) {
+        rejectRequest(HttpResponse::RequestEntryTooLarge);
+        return false;
+    }
+
+    if (m_request.contentType() == HttpContentType::ApplicationFromUrlEncoded && isFormTooLarge(m_contentLength)) {
+        rejectRequest(HttpResponse::RequestEntryTooLarge);
+        return false;
+    }
+
+    bool expectContinue = false;
+    QString expect = m_request.option(HttpOption::Expect).toString().trimmed();
+    if (!expect.isEmpty()) {
+        if (expect.toLower() != "100-continue") {
+            rejectRequest(HttpResponse::ExpectationFailed);
+            return false;
+        }
+        // HTTP/1.0 clients do not know about interim responses.
+        expectContinue = hasBody && (m_request.majorVersion() > 1 ||
+                                     (m_request.majorVersion() == 1 && m_request.minorVersion() >= 1));
+    }
+
+    m_request.body().setSpillThreshold(m_pConfig->bodySpillThreshold());
+
+    const HttpRequestHeadersFunction &admit = m_pConfig->admissionHandler();
+    if (!admit.isNull() && !admit(m_request, m_response)) {
+        rejectRequest(rejectionStatus());
+        return false;
+    }
+
+    if (m_pRequestHandler != nullptr && !m_pRequestHandler->handleRequestHeaders(m_request, m_response)) {
+        // Rejected by the handler
+        rejectRequest(rejectionStatus());
+        return false;
+    }
+
+    // The route has set the priority, the classifier may override it
+    const HttpPriorityClassifier &classify = m_pConfig->priorityClassifier();
+    if (!classify.isNull()) {
+        m_request.setPriority(classify(m_request));
+    }
+    m_priority = m_request.priority();
+
+    m_multipart = false;
+    if (m_request.body().consumer().isNull() && m_request.contentType() == HttpContentType::MultipartFormData) {
+        // Parse the form as it arrives rather than storing the body.
+        QByteArray boundary = m_request.contentType().parameter("boundary").toLatin1();
+        if (boundary.isEmpty()) {
+            rejectRequest(HttpResponse::BadRequest);
+            return false;
+        }
+        m_multipartParser.reset(boundary);
+        m_multipartParser.setSpillThreshold(m_pConfig->bodySpillThreshold());
+        // Parts kept in memory are bound like an in-memory body
+        qint64 maxMemorySize = HttpRequestBody::MaxMemorySize;
+        if (maxBodySize > 0 && maxBodySize < maxMemorySize) {
+            maxMemorySize = maxBodySize;
+        }
+        m_multipartParser.setMaxMemorySize(maxMemorySize);
+        m_multipart = true;
+
+        HttpMultipartParser *pParser = &m_multipartParser;
+        m_request.body().setConsumer([pParser](const char *data, qint64 size) {
+            pParser->feed(data, size);
+        });
+    }
+
+    if (m_contentLength > 0 && !m_request.body().accepts(m_contentLength)) {
+        rejectRequest(HttpResponse::RequestEntryTooLarge);
+        return false;
+    }
+
+    if (m_contentLength > 0 && !m_request.body().reserve(m_contentLength)) {
+        // Unable to store the body
+        rejectRequest(HttpResponse::InternalServerError);
+        return false;
+    }
+
+    if (expectContinue) {
+        // The body will be accepted, let the client send it.
+        QString str = QString("HTTP/%1.%2 %3 %4\r\n\r\n")
+                .arg(m_request.majorVersion())
+                .arg(m_request.minorVersion())
+                .arg(static_cast<int>(HttpResponse::Continue))
+                .arg(HttpResponse::statusToString(HttpResponse::Continue));
+        m_pSocket->write(str.toLatin1());
+    }
+
+    return true;
+}
+
+HttpResponse::Status HttpClientHandler::rejectionStatus() const
+{
+    HttpResponse::Status status = m_response.status();
+    if (status == HttpResponse::Ok || status == HttpResponse::Invalid) {
+        // Status has not been set by the rejecting handler
+        status = HttpResponse::Forbidden;
+    }
+    return status;
+}
+
+bool HttpClientHandler::isHeaderTooLarge(qint64 size) const
+{
+    // The query is decoded into an arena along with form arguments
+    qint64 maxHeaderSize = m_pConfig->maxHeaderSize();
+    if (maxHeaderSize <= 0 || maxHeaderSize > HttpArena::MaxCapacity / 2) {
+        maxHeaderSize = HttpArena::MaxCapacity / 2;
+    }
+    return size > maxHeaderSize;
+}
+
+bool HttpClientHandler::isFormTooLarge(qint64 size) const
+{
+    // Decoded arguments must fit in an arena along with the query ones
+    qint64 maxFormSize = m_pConfig->maxFormSize();
+    if (maxFormSize <= 0 || maxFormSize > HttpArena::MaxCapacity / 2) {
+        maxFormSize = HttpArena::MaxCapacity / 2;
+    }
+    return size > maxFormSize;
+}
+
+bool HttpClientHandler::appendBody(const char *data, qint64 size)
+{
+    if (m_pInflater == nullptr) {
+        return storeBody(data, size);
+    }
+
+    qint64 pos = 0;
+    do {
+        const char *pOutput = nullptr;
+        qint64 outputSize = 0;
+        pos += m_pInflater->inflate(data + pos, size - pos, &pOutput, &outputSize);
+        if (m_pInflater->hasError()) {
+            rejectRequest(HttpResponse::BadRequest);
+            return false;
+        }
+        if (outputSize > 0 && !storeBody(pOutput, outputSize)) {
+            return false;
+        }
+    } while (pos < size || m_pInflater->hasPendingOutput());
+
+    return true;
+}
+
+bool HttpClientHandler::storeBody(const char *data, qint64 size)
+{
+    HttpRequestBody &body = m_request.body();
+
+    qint64 maxBodySize = m_pConfig->maxBodySize();
+    if (maxBodySize > 0 && body.size() + size > maxBodySize) {
+        rejectRequest(HttpResponse::RequestEntryTooLarge);
+        return false;
+    }
+
+    if (m_pInflater != nullptr) {
+        // Guard against decompression bombs
+        qint64 maxInflatedSize = m_pConfig->maxInflatedBodySize();
+        if (maxInflatedSize > 0 && body.size() + size > maxInflatedSize) {
+            rejectRequest(HttpResponse::RequestEntryTooLarge);
+            return false;
+        }
+    }
+
+    if (!body.accepts(body.size() + size)) {
+        rejectRequest(HttpResponse::RequestEntryTooLarge);
+        return false;
+    }
+
+    if (!body.append(data, size)) {
+        rejectRequest(HttpResponse::InternalServerError);
+        return false;
+    }
+
+    if (m_multipart && m_multipartParser.hasError()) {
+        // Do not read the rest of a malformed form
+        rejectRequest(m_multipartParser.isTooLarge() ? HttpResponse::RequestEntryTooLarge
+                                                     : HttpResponse::BadRequest);
+        return false;
+    }
+
+    return true;
+}
+
+void HttpClientHandler::releaseInflater()
+{
+    HttpInflater::release(m_pInflater);
+    m_pInflater = nullptr;
+}
+
+void HttpClientHandler::rejectRequest(HttpResponse::Status status)
+{
+    m_response.setStatus(status);
+
+    // The rest of the request is not read,
+    // so the connection cannot be reused.
+    m_response.setOption(HttpOption::Connection, "Close");
+    setState(State_FinishResponse, true);
+}
+
+void HttpClientHandler::detachDeferredResponse()
+{
+    if (!m_deferred.isNull()) {
+        QMutexLocker locker(&m_deferred->mutex);
+        m_deferred->pending = false;
+        m_deferred->pReceiver = nullptr;
+    }
+    m_deferred.clear();
 }
 
 void HttpClientHandler::setState(State s, bool scheduleUpdate)
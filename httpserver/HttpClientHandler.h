@@ -20,13 +20,23 @@
 #define HTTPCLIENTHANDLER_H
 
 #include <QObject>
+#include <QHostAddress>
+#include <QSharedPointer>
 #include "HttpServerApi.h"
 #include "IHttpClientHandler.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
+#include "HttpChunkedDecoder.h"
+#include "HttpMultipartParser.h"
+#include "HttpTimingWheel.h"
 
 class QTcpSocket;
 class HttpRequestHandler;
+class HttpServerConfig;
+class HttpDeferredResponseState;
+class HttpInflater;
+class HttpConnectionLimiter;
+class HttpScheduler;
 
 class HTTP_API HttpClientHandler : public QObject, public IHttpClientHandler
 {
@@ -38,24 +48,55 @@ public:
         State_Ready,                    ///< Initial state.
         State_ReceiveRequest,           ///< Waiting for incoming request.
         State_ReceiveRequestOptions,    ///< Receive HTTP options.
-        State_ReceiveRequestStringData, ///< Receive string-type data.
-        State_ReceiveRequestBinaryData, ///< Receive binary-encoded data.
+        State_ReceiveRequestBinaryData, ///< Receive data of known length.
+        State_ReceiveRequestChunkedData,///< Receive chunked data.
         State_ProcessRequest,           ///< Processing received request.
+        State_WaitProcessRequest,       ///< Wait for the scheduler to run the request.
         State_WaitFinishResponse,       ///< Wait for response finalization.
         State_FinishResponse,           ///< Finalize response.
         State_CloseClient               ///< Close communication.
     };
 
-    HttpClientHandler(qintptr handle, HttpRequestHandler *pRequestHandler, QObject *pParent = nullptr);
+    HttpClientHandler(qintptr handle,
+                      HttpRequestHandler *pRequestHandler,
+                      const HttpServerConfig *pConfig,
+                      QObject *pParent = nullptr);
+
+    /**
+     * Construct an idle handler, to be given a connection with open().
+     */
+    HttpClientHandler(HttpRequestHandler *pRequestHandler,
+                      const HttpServerConfig *pConfig,
+                      QObject *pParent = nullptr);
     ~HttpClientHandler();
 
     void finalizeResponse();
+    HttpDeferredResponse deferResponse();
+    HttpExchange takeExchange();
+
+    /// Connection ID assigned by the server (see HttpConnectionRegistry).
+    int connectionId() const { return m_connectionId; }
+    void setConnectionId(int id) { m_connectionId = id; }
+
+    /**
+     * Set the limiter counting connections per client address.
+     * Connections over the limit are rejected when opened.
+     */
+    void setConnectionLimiter(HttpConnectionLimiter *pLimiter) { m_pLimiter = pLimiter; }
 
     bool isKeepAlive() const { return m_keepAlive; }
     void setKeepAlive(bool v) { m_keepAlive = v; }
 
 public slots:
 
+    /**
+     * Start handling a connection.
+     * The handler must be idle: just constructed or closed.
+     * Buffers of the previous connection are kept for reuse.
+     * @param handle Socket descriptor.
+     */
+    void open(qintptr handle);
+
     /**
      * Close communication channel.
      */
@@ -69,13 +110,17 @@ private slots:
 
     /// Handle socket disconnection.
     void onDisconnect();
+    /// Handle the end of a connection closed by the server.
+    void onClosed();
     /// Handle incoming data.
     void onDataAvailable();
+    /// Handle response data written to the socket.
+    void onBytesWritten();
 
     void receiveRequest();
     void receiveOptions();
-    void receiveStringData();
     void receiveBinaryData();
+    void receiveChunkedData();
     void processRequest();
     void waitFinishResponse();
     void finishResponse();
@@ -84,22 +129,138 @@ private slots:
     /// Handle current state.
     void handleState();
     void handleStateAsync();
+    /// Handle current state, unless the connection is no longer served.
+    void onStateUpdate(int generation);
+
+    /// Apply resolved deferred response.
+    void onDeferredResponseResolved();
+    /// Handle response finalization timeout.
+    void onResponseTimeout();
 
 private:
 
+    friend class HttpScheduler;
+
+    /**
+     * Pass the request to the request handler,
+     * when scheduled (see HttpScheduler).
+     */
+    void dispatchRequest();
+
+    /// Remove the handler from the scheduler's queue (if queued).
+    void unschedule();
+
+    /// Timeout the handler is waiting for.
+    enum Timeout {
+        Timeout_None,
+        Timeout_Header,     ///< Request line and headers.
+        Timeout_Body,       ///< Pause while receiving the body.
+        Timeout_KeepAlive,  ///< Idle connection.
+        Timeout_Response,   ///< Response finalization.
+        Timeout_Write,      ///< Pause while sending the response.
+        Timeout_Linger      ///< Flushing output of a closed connection.
+    };
+
+    /**
+     * Arm the connection timeout.
+     * @param timeout Timeout kind.
+     * @param ms Timeout in milliseconds, zero disables it.
+     */
+    void startTimeout(Timeout timeout, int ms);
+    void stopTimeout();
+
+    /// Arm the timeout of a connection waiting for a new request.
+    void startIdleTimeout();
+
+    /// Handle connection timeout.
+    void onTimeout();
+
     void setState(State s, bool scheduleUpdate = false);
 
+    /**
+     * Check request headers before receiving the body:
+     * enforce the body size limit, run the admission handler and
+     * let the request handler inspect the headers and set up the body
+     * storage. Answers 100 Continue if the client waits for it.
+     * @param hasBody Whether the request announces a body.
+     * @return false if the request has been rejected.
+     */
+    bool admitRequest(bool hasBody);
+
+    /// Status to reject the request with after a handler refused it.
+    HttpResponse::Status rejectionStatus() const;
+
+    /// Whether the request line and headers of the given size are to be refused.
+    bool isHeaderTooLarge(qint64 size) const;
+
+    /// Whether a url-encoded form of the given size is to be refused.
+    bool isFormTooLarge(qint64 size) const;
+
+    /**
+     * Store a chunk of the request body.
+     * @return false if the request has been rejected.
+     */
+    bool appendBody(const char *data, qint64 size);
+
+    /**
+     * Store a chunk of the (decompressed) request body.
+     * @return false if the request has been rejected.
+     */
+    bool storeBody(const char *data, qint64 size);
+
+    /// Return the inflater (if any) to the pool.
+    void releaseInflater();
+
+    /// Answer the request without receiving the rest of it.
+    void rejectRequest(HttpResponse::Status status);
+
+    /// Detach deferred response (if any) from this handler.
+    void detachDeferredResponse();
+
+    /**
+     * Cancel the request being served (see HttpCancellationToken),
+     * including one taken out as an exchange.
+     */
+    void cancelRequest(HttpCancellationToken::Reason reason);
+
     State m_state;
 
     QTcpSocket *m_pSocket;
+    int m_connectionId;         ///< ID in the server's registry.
+    int m_generation;           ///< Number of connections opened, tells stale calls.
+    bool m_closing;             ///< Closed, but the socket is still flushing.
+    HttpConnectionLimiter *m_pLimiter;  ///< Per-address connection limiter.
+    QHostAddress m_peerAddress; ///< Client address.
+    bool m_addressAcquired;     ///< Whether counted by the limiter.
     bool m_keepAlive;
 
     HttpRequest m_request;      ///< Received request.
     HttpResponse m_response;    ///< Response to be sent back.
     qint64 m_contentReceived;   ///< Content length (received so far).
     qint64 m_contentLength;     ///< Content length (in bytes).
+    HttpChunkedDecoder m_chunkedDecoder;    ///< Decoder of chunked data.
+    HttpMultipartParser m_multipartParser;  ///< Parser of multipart forms.
+    bool m_multipart;           ///< Body is passed to the multipart parser.
+    HttpInflater *m_pInflater;  ///< Decompressor of the request body.
+    qint64 m_headerSize;        ///< Request line and headers size (received so far).
+    qint64 m_receivedTime;      ///< When request headers were complete (scheduler clock), -1 if not yet.
+    qint64 m_readyTime;         ///< When the request was handed to the scheduler (scheduler clock).
+    HttpRequest::Priority m_priority;   ///< Priority class of the request.
+    HttpScheduler *m_pScheduler;        ///< Scheduler the handler is queued in.
+    HttpRequest::Priority m_scheduledPriority;  ///< Scheduler's queue the handler is in.
+    HttpClientHandler *m_pPrevScheduled;        ///< Previous handler in the scheduler's queue.
+    HttpClientHandler *m_pNextScheduled;        ///< Next handler in the scheduler's queue.
 
     HttpRequestHandler *m_pRequestHandler;
+    const HttpServerConfig *m_pConfig;
+
+    /// State of the deferred response (if deferred).
+    QSharedPointer<HttpDeferredResponseState> m_deferred;
+    /// Cancellation token of the request taken out as an exchange.
+    HttpCancellationToken m_cancellation;
+    /// Connection timeout (on the thread's timing wheel).
+    HttpTimeout m_timeout;
+    Timeout m_timeoutKind;      ///< Timeout being waited for.
 };
 
 #endif // HTTPCLIENTHANDLER_H
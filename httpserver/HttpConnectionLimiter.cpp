@@ -0,0 +1,67 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include "HttpConnectionLimiter.h"
+
+HttpConnectionLimiter::HttpConnectionLimiter()
+    : m_maxPerAddress(0),
+      m_rejection(),
+      m_mutex(),
+      m_addressCounts(),
+      m_rejected(0),
+      m_deferred(0)
+{
+    setRetryAfter(1);
+}
+
+void HttpConnectionLimiter::setRetryAfter(int seconds)
+{
+    m_rejection = QByteArray("HTTP/1.1 503 Service Unavailable\r\n"
+                             "Retry-After: ") + QByteArray::number(seconds) +
+                  QByteArray("\r\n"
+                             "Content-Length: 0\r\n"
+                             "Connection: close\r\n"
+                             "\r\n");
+}
+
+bool HttpConnectionLimiter::acquire(const QHostAddress &address)
+{
+    if (m_maxPerAddress <= 0) {
+        return true;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    int &count = m_addressCounts[address];
+    if (count >= m_maxPerAddress) {
+        return false;
+    }
+    count++;
+    return true;
+}
+
+void HttpConnectionLimiter::release(const QHostAddress &address)
+{
+    if (m_maxPerAddress <= 0) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    QHash<QHostAddress, int>::iterator it = m_addressCounts.find(address);
+    if (it != m_addressCounts.end() && --it.value() == 0) {
+        m_addressCounts.erase(it);
+    }
+}
@@ -0,0 +1,92 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPCONNECTIONLIMITER_H
+#define HTTPCONNECTIONLIMITER_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QMutex>
+#include "HttpServerApi.h"
+
+/**
+ * Connection admission state shared by the server and its handlers.
+ *
+ * Counts live connections per client address, holds the pre-serialized
+ * response sent to rejected connections, and counts rejected and
+ * deferred accepts. All methods are thread-safe.
+ */
+class HTTP_API HttpConnectionLimiter
+{
+public:
+
+    HttpConnectionLimiter();
+
+    /**
+     * Maximum number of connections from one address, zero means no limit.
+     * Should be set before the server is started.
+     */
+    int maxPerAddress() const { return m_maxPerAddress; }
+    void setMaxPerAddress(int count) { m_maxPerAddress = count; }
+
+    /**
+     * Set the delay (in seconds) suggested to rejected clients
+     * and serialize the rejection response.
+     * Should be set before the server is started.
+     */
+    void setRetryAfter(int seconds);
+
+    /**
+     * Response sent to rejected connections:
+     * 503 Service Unavailable with Retry-After.
+     */
+    const QByteArray& rejection() const { return m_rejection; }
+
+    /**
+     * Count a connection from an address.
+     * @return false if the address has too many connections.
+     */
+    bool acquire(const QHostAddress &address);
+
+    /**
+     * Uncount a connection acquired before.
+     */
+    void release(const QHostAddress &address);
+
+    /// Number of connections rejected.
+    quint64 rejected() const { return m_rejected.load(); }
+    void addRejected() { m_rejected.fetchAndAddRelaxed(1); }
+
+    /// Number of times accepting has been paused.
+    quint64 deferred() const { return m_deferred.load(); }
+    void addDeferred() { m_deferred.fetchAndAddRelaxed(1); }
+
+private:
+
+    Q_DISABLE_COPY(HttpConnectionLimiter)
+
+    int m_maxPerAddress;            ///< Per-address limit.
+    QByteArray m_rejection;         ///< Serialized rejection response.
+    QMutex m_mutex;                 ///< Protects the address counts.
+    QHash<QHostAddress, int> m_addressCounts;   ///< Live connections per address.
+    QAtomicInteger<quint64> m_rejected;         ///< Rejected connections.
+    QAtomicInteger<quint64> m_deferred;         ///< Accept pauses.
+};
+
+#endif // HTTPCONNECTIONLIMITER_H
@@ -0,0 +1,66 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include "HttpConnectionRegistry.h"
+
+HttpConnectionRegistry::HttpConnectionRegistry()
+    : m_slots(),
+      m_firstFree(-1),
+      m_count(0)
+{
+}
+
+int HttpConnectionRegistry::insert(HttpClientHandler *pHandler)
+{
+    Q_ASSERT(pHandler != nullptr);
+
+    int id = m_firstFree;
+    if (id >= 0) {
+        m_firstFree = m_slots.at(id).nextFree;
+    } else {
+        id = m_slots.count();
+        m_slots.append(Slot());
+    }
+
+    Slot &slot = m_slots[id];
+    slot.pHandler = pHandler;
+    slot.nextFree = -1;
+    m_count.ref();
+    return id;
+}
+
+bool HttpConnectionRegistry::remove(int id, HttpClientHandler *pHandler)
+{
+    if (id < 0 || id >= m_slots.count() || m_slots.at(id).pHandler != pHandler || pHandler == nullptr) {
+        return false;
+    }
+
+    Slot &slot = m_slots[id];
+    slot.pHandler = nullptr;
+    slot.nextFree = m_firstFree;
+    m_firstFree = id;
+    m_count.deref();
+    return true;
+}
+
+HttpClientHandler* HttpConnectionRegistry::at(int id) const
+{
+    if (id < 0 || id >= m_slots.count()) {
+        return nullptr;
+    }
+    return m_slots.at(id).pHandler;
+}
@@ -0,0 +1,94 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPCONNECTIONREGISTRY_H
+#define HTTPCONNECTIONREGISTRY_H
+
+#include <QAtomicInt>
+#include <QVector>
+#include "HttpServerApi.h"
+
+class HttpClientHandler;
+
+/**
+ * Registry of live connections.
+ *
+ * Handlers are kept in a slab: a handler's ID is the index of its slot,
+ * and free slots are chained in a list, so inserting and removing are
+ * O(1) regardless of the number of connections. IDs are reused.
+ *
+ * The registry is not thread-safe, except for count() which can be
+ * read from any thread.
+ */
+class HTTP_API HttpConnectionRegistry
+{
+public:
+
+    HttpConnectionRegistry();
+
+    /**
+     * Register a handler.
+     * @return Handler ID.
+     */
+    int insert(HttpClientHandler *pHandler);
+
+    /**
+     * Unregister a handler.
+     * @param id Handler ID.
+     * @param pHandler Handler expected under this ID.
+     * @return false if the ID does not belong to the handler
+     *         (e.g. the handler has been removed already).
+     */
+    bool remove(int id, HttpClientHandler *pHandler);
+
+    /**
+     * Handler registered under the ID, nullptr if none.
+     */
+    HttpClientHandler* at(int id) const;
+
+    /// Number of registered handlers.
+    int count() const { return m_count.load(); }
+    bool isEmpty() const { return count() == 0; }
+
+    /**
+     * Call a function for each registered handler.
+     * The function must not insert or remove handlers.
+     */
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (int i = 0; i < m_slots.count(); i++) {
+            if (m_slots.at(i).pHandler != nullptr) {
+                f(m_slots.at(i).pHandler);
+            }
+        }
+    }
+
+private:
+
+    struct Slot
+    {
+        HttpClientHandler *pHandler;    ///< Registered handler, nullptr if free.
+        int nextFree;                   ///< Next free slot, -1 if none.
+    };
+
+    QVector<Slot> m_slots;
+    int m_firstFree;    ///< First free slot, -1 if none.
+    QAtomicInt m_count; ///< Number of registered handlers.
+};
+
+#endif // HTTPCONNECTIONREGISTRY_H
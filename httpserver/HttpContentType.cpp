@@ -29,7 +29,9 @@ const HttpContentType HttpContentType::ApplicationXhtmlXml("application", "xhtml
 const HttpContentType HttpContentType::ApplicationZip("application", "zip");
 const HttpContentType HttpContentType::ApplicationGzip("application", "x-gzip");
 const HttpContentType HttpContentType::ApplicationDicom("application", "dicom");
-const HttpContentType HttpContentType::ApplicationFromUrlEncoded("application", "x-www-from-urlencoded");
+const HttpContentType HttpContentType::ApplicationFromUrlEncoded("application", "x-www-form-urlencoded");
+
+const HttpContentType HttpContentType::MultipartFormData("multipart", "form-data");
 
 const HttpContentType HttpContentType::ImageGif("image", "gif");
 const HttpContentType HttpContentType::ImageJpeg("image", "jpeg");
@@ -73,26 +75,46 @@ QMap<QString, HttpContentType> cExtToContentMap {
 
 HttpContentType::HttpContentType()
     : m_type(),
-      m_media()
+      m_media(),
+      m_parameters()
 {
 }
 
 HttpContentType::HttpContentType(const QString &type, const QString &media)
     : m_type(type),
-      m_media(media)
+      m_media(media),
+      m_parameters()
 {
 }
 
 HttpContentType::HttpContentType(const QString &str)
+    : m_type(),
+      m_media(),
+      m_parameters()
 {
-    int pos = str.indexOf("/");
-    m_type = str.left(pos);
-    m_media = str.mid(pos + 1);
+    // type/media; name=value; name="quoted value"
+    QStringList list = str.split(";", QString::SkipEmptyParts);
+    QString typeMedia = list.isEmpty() ? QString() : list.takeFirst().trimmed().toLower();
+    int pos = typeMedia.indexOf("/");
+    m_type = typeMedia.left(pos);
+    m_media = typeMedia.mid(pos + 1);
+
+    foreach (const QString &param, list) {
+        pos = param.indexOf("=");
+        if (pos > 0) {
+            QString value = param.mid(pos + 1).trimmed();
+            if (value.length() >= 2 && value.startsWith('"') && value.endsWith('"')) {
+                value = value.mid(1, value.length() - 2);
+            }
+            m_parameters[param.left(pos).trimmed().toLower()] = value;
+        }
+    }
 }
 
 HttpContentType::HttpContentType(const HttpContentType &ct)
     : m_type(ct.m_type),
-      m_media(ct.m_media)
+      m_media(ct.m_media),
+      m_parameters(ct.m_parameters)
 {
 }
 
@@ -101,6 +123,7 @@ HttpContentType& HttpContentType::operator =(const HttpContentType &ct)
     if (this != &ct) {
         m_type = ct.m_type;
         m_media = ct.m_media;
+        m_parameters = ct.m_parameters;
     }
     return *this;
 }
@@ -117,7 +140,11 @@ bool HttpContentType::operator !=(const HttpContentType &ct) const
 
 QString HttpContentType::toString() const
 {
-    return QString("%1/%2").arg(m_type).arg(m_media);
+    QString str = QString("%1/%2").arg(m_type).arg(m_media);
+    for (QMap<QString, QString>::const_iterator it = m_parameters.constBegin(); it != m_parameters.constEnd(); ++it) {
+        str += QString("; %1=%2").arg(it.key()).arg(it.value());
+    }
+    return str;
 }
 
 HttpContentType HttpContentType::fromFileExtension(const QString &ext)
@@ -18,12 +18,14 @@
 #ifndef HTTPCONTENTTYPE_H
 #define HTTPCONTENTTYPE_H
 
+#include <QMap>
 #include <QString>
 #include "HttpServerApi.h"
 
 /**
  * HTTP content type encoded
- * as type/media pair.
+ * as type/media pair with optional parameters
+ * (e.g. charset or multipart boundary).
  */
 class HTTP_API HttpContentType
 {
@@ -42,6 +44,8 @@ public:
     const static HttpContentType ApplicationDicom;
     const static HttpContentType ApplicationFromUrlEncoded;
 
+    const static HttpContentType MultipartFormData;
+
     const static HttpContentType ImageGif;
     const static HttpContentType ImageJpeg;
     const static HttpContentType ImagePjpeg;
@@ -63,6 +67,7 @@ public:
     HttpContentType(const QString &type, const QString &media);
     HttpContentType(const HttpContentType &ct);
     HttpContentType& operator =(const HttpContentType &ct);
+    /// Content types are compared by type and media, parameters are ignored.
     bool operator ==(const HttpContentType &ct) const;
     bool operator !=(const HttpContentType &ct) const;
 
@@ -72,6 +77,14 @@ public:
     QString media() const { return m_media; }
     void setMedia(const QString &s) { m_media = s; }
 
+    /**
+     * Get content type parameter.
+     * @param name Parameter name (lower case).
+     * @return Parameter value, or empty string if not set.
+     */
+    QString parameter(const QString &name) const { return m_parameters.value(name); }
+    void setParameter(const QString &name, const QString &value) { m_parameters[name.toLower()] = value; }
+
     QString toString() const;
 
     /**
@@ -84,6 +97,7 @@ public:
 private:
     QString m_type;     ///< Content type.
     QString m_media;    ///< Content media.
+    QMap<QString, QString> m_parameters;    ///< Parameters.
 };
 
 #endif // HTTPCONTENTTYPE_H
@@ -0,0 +1,161 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <QFile>
+#include <QThread>
+#include "HttpCpuTopology.h"
+
+#ifdef Q_OS_LINUX
+#   include <pthread.h>
+#   include <sched.h>
+#endif
+
+/// Read a one-line file from /sys.
+static QString readSysFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromLatin1(file.readAll()).trimmed();
+}
+
+HttpCpuTopology::HttpCpuTopology()
+    : m_nodes()
+{
+}
+
+HttpCpuTopology HttpCpuTopology::detect()
+{
+    HttpCpuTopology topology;
+
+    const QString sysNode("/sys/devices/system/node/");
+    foreach (int number, parseCpuList(readSysFile(sysNode + "online"))) {
+        Node node;
+        node.number = number;
+        node.cpus = parseCpuList(readSysFile(sysNode + QString("node%1/cpulist").arg(number)));
+        if (!node.cpus.isEmpty()) {
+            topology.m_nodes.append(node);
+        }
+    }
+
+    if (topology.m_nodes.isEmpty()) {
+        // No NUMA information, assume one node
+        Node node;
+        node.number = 0;
+        int count = QThread::idealThreadCount();
+        for (int i = 0; i < count; i++) {
+            node.cpus.append(i);
+        }
+        topology.m_nodes.append(node);
+    }
+
+    return topology;
+}
+
+int HttpCpuTopology::indexOfNode(int number) const
+{
+    for (int i = 0; i < m_nodes.count(); i++) {
+        if (m_nodes.at(i).number == number) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+HttpCpuTopology::CpuSet HttpCpuTopology::allCpus() const
+{
+    CpuSet cpus;
+    foreach (const Node &node, m_nodes) {
+        cpus.append(node.cpus);
+    }
+    return cpus;
+}
+
+QList<HttpCpuTopology::CpuSet> HttpCpuTopology::coreSets(int first) const
+{
+    QList<CpuSet> sets;
+    for (int i = 0; ; i++) {
+        bool found = false;
+        for (int n = 0; n < m_nodes.count(); n++) {
+            const Node &node = m_nodes.at((first + n) % m_nodes.count());
+            if (i < node.cpus.count()) {
+                sets.append(CpuSet() << node.cpus.at(i));
+                found = true;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+    return sets;
+}
+
+QList<HttpCpuTopology::CpuSet> HttpCpuTopology::nodeSets(int first) const
+{
+    QList<CpuSet> sets;
+    for (int n = 0; n < m_nodes.count(); n++) {
+        sets.append(m_nodes.at((first + n) % m_nodes.count()).cpus);
+    }
+    return sets;
+}
+
+int HttpCpuTopology::interfaceNode(const QString &name)
+{
+    bool ok = false;
+    int node = readSysFile(QString("/sys/class/net/%1/device/numa_node").arg(name)).toInt(&ok);
+    return ok ? node : -1;
+}
+
+bool HttpCpuTopology::pinCurrentThread(const CpuSet &cpus)
+{
+    if (cpus.isEmpty()) {
+        return false;
+    }
+
+#ifdef Q_OS_LINUX
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    foreach (int cpu, cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+HttpCpuTopology::CpuSet HttpCpuTopology::parseCpuList(const QString &str)
+{
+    CpuSet cpus;
+    foreach (const QString &range, str.split(',', QString::SkipEmptyParts)) {
+        int dash = range.indexOf('-');
+        bool ok1 = false;
+        bool ok2 = false;
+        int first = range.left(dash < 0 ? range.size() : dash).trimmed().toInt(&ok1);
+        int last = dash < 0 ? first : range.mid(dash + 1).trimmed().toInt(&ok2);
+        if (!ok1 || (dash >= 0 && !ok2)) {
+            continue;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.append(cpu);
+        }
+    }
+    return cpus;
+}
@@ -0,0 +1,101 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPCPUTOPOLOGY_H
+#define HTTPCPUTOPOLOGY_H
+
+#include <QList>
+#include <QString>
+#include "HttpServerApi.h"
+
+/**
+ * CPUs of the host grouped by NUMA node.
+ *
+ * On Linux the topology is read from /sys; elsewhere (or if /sys
+ * cannot be read) all the CPUs are reported as one node.
+ */
+class HTTP_API HttpCpuTopology
+{
+public:
+
+    /// CPU numbers.
+    typedef QList<int> CpuSet;
+
+    HttpCpuTopology();
+
+    /**
+     * Detect the topology of this host.
+     */
+    static HttpCpuTopology detect();
+
+    int nodeCount() const { return m_nodes.count(); }
+
+    /// CPUs of a node (by index, not NUMA node number).
+    const CpuSet& cpus(int index) const { return m_nodes.at(index).cpus; }
+
+    /// NUMA node number of a node.
+    int nodeNumber(int index) const { return m_nodes.at(index).number; }
+
+    /// Index of a NUMA node, -1 if unknown.
+    int indexOfNode(int number) const;
+
+    /// All CPUs.
+    CpuSet allCpus() const;
+
+    /**
+     * CPUs one per set, alternating between nodes so that
+     * consecutive sets are spread over the host.
+     * @param first Index of the node to start with.
+     */
+    QList<CpuSet> coreSets(int first = 0) const;
+
+    /**
+     * CPUs grouped by node.
+     * @param first Index of the node to start with.
+     */
+    QList<CpuSet> nodeSets(int first = 0) const;
+
+    /**
+     * NUMA node a network interface is attached to.
+     * @param name Interface name, e.g. "eth0".
+     * @return Node number, -1 if unknown.
+     */
+    static int interfaceNode(const QString &name);
+
+    /**
+     * Restrict the current thread to a set of CPUs.
+     * @return false if not supported or the set cannot be applied.
+     */
+    static bool pinCurrentThread(const CpuSet &cpus);
+
+    /**
+     * Parse a CPU list as found in /sys, e.g. "0-3,8-11".
+     */
+    static CpuSet parseCpuList(const QString &str);
+
+private:
+
+    struct Node
+    {
+        int number;     ///< NUMA node number.
+        CpuSet cpus;    ///< CPUs of the node.
+    };
+
+    QList<Node> m_nodes;
+};
+
+#endif // HTTPCPUTOPOLOGY_H
@@ -0,0 +1,82 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <QObject>
+#include "HttpDeferredResponse.h"
+
+HttpDeferredResponseState::HttpDeferredResponseState(QObject *pReceiver)
+    : mutex(),
+      pReceiver(pReceiver),
+      pending(true),
+      resolver()
+{
+}
+
+HttpDeferredResponse::HttpDeferredResponse()
+    : m_state()
+{
+}
+
+HttpDeferredResponse::HttpDeferredResponse(const QSharedPointer<HttpDeferredResponseState> &state)
+    : m_state(state)
+{
+}
+
+bool HttpDeferredResponse::isPending() const
+{
+    if (m_state.isNull()) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_state->mutex);
+    return m_state->pending && m_state->pReceiver != nullptr;
+}
+
+bool HttpDeferredResponse::resolve(const HttpResponseResolver &resolver)
+{
+    Q_ASSERT(!resolver.isNull());
+
+    if (m_state.isNull()) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_state->mutex);
+    if (!m_state->pending || m_state->pReceiver == nullptr) {
+        // Already resolved, timed out or the connection is gone.
+        return false;
+    }
+
+    m_state->pending = false;
+    m_state->resolver = resolver;
+
+    // The receiver detaches itself under the same mutex before
+    // being destroyed, so it is safe to post to it here.
+    QMetaObject::invokeMethod(m_state->pReceiver, "onDeferredResponseResolved", Qt::QueuedConnection);
+
+    return true;
+}
+
+bool HttpDeferredResponse::resolve(HttpResponse::Status status,
+                                   const QByteArray &data,
+                                   const HttpContentType &contentType)
+{
+    return resolve([status, data, contentType](HttpResponse &response) {
+        response.setStatus(status);
+        response.setContentType(contentType);
+        response.setData(data);
+    });
+}
@@ -0,0 +1,108 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPDEFERREDRESPONSE_H
+#define HTTPDEFERREDRESPONSE_H
+
+#include <QMutex>
+#include <QSharedPointer>
+#include "HttpServerApi.h"
+#include "HttpFunction.h"
+#include "HttpResponse.h"
+
+/// Function applied to the response when a deferred response is resolved.
+typedef HttpFunction<void(HttpResponse&)> HttpResponseResolver;
+
+/**
+ * Shared state of a deferred response.
+ * This is an internal object shared between HttpDeferredResponse
+ * copies and the client handler that issued it.
+ */
+class HttpDeferredResponseState
+{
+public:
+
+    explicit HttpDeferredResponseState(QObject *pReceiver);
+
+    QMutex mutex;                   ///< Protective mutex.
+    QObject *pReceiver;             ///< Client handler, nullptr once detached.
+    bool pending;                   ///< Whether the response is still to be resolved.
+    HttpResponseResolver resolver;  ///< Resolver to be applied by the client handler.
+};
+
+/**
+ * Completion token of an asynchronous response.
+ *
+ * A handler calls HttpResponse::defer() and returns immediately,
+ * keeping the token. The token can then be resolved from any thread
+ * (e.g. from a database callback): the resolver is marshalled back
+ * to the thread of the connection, applied to the response there,
+ * and the response is finalized.
+ *
+ * A deferred response that is not resolved within the route's
+ * timeout is answered with 504 Gateway Timeout. Resolving a token
+ * after the timeout, or after the client has gone, has no effect.
+ * Tokens are cheap to copy; all copies share the same state.
+ */
+class HTTP_API HttpDeferredResponse
+{
+public:
+
+    /**
+     * Construct a null token.
+     */
+    HttpDeferredResponse();
+
+    bool isNull() const { return m_state.isNull(); }
+
+    /**
+     * Tells whether the response is still waiting to be resolved.
+     * This method is thread-safe.
+     */
+    bool isPending() const;
+
+    /**
+     * Resolve the response.
+     * This method is thread-safe. The resolver is called in the
+     * connection's thread and should not block.
+     * @param resolver Function filling in the response.
+     * @return false if the response has already been resolved or timed out.
+     */
+    bool resolve(const HttpResponseResolver &resolver);
+
+    /**
+     * Resolve the response with status and data.
+     * This method is thread-safe.
+     * @param status Response status.
+     * @param data Response data.
+     * @param contentType Response content type.
+     * @return false if the response has already been resolved or timed out.
+     */
+    bool resolve(HttpResponse::Status status,
+                 const QByteArray &data = QByteArray(),
+                 const HttpContentType &contentType = HttpContentType::TextHtml);
+
+private:
+
+    friend class HttpClientHandler;
+
+    explicit HttpDeferredResponse(const QSharedPointer<HttpDeferredResponseState> &state);
+
+    QSharedPointer<HttpDeferredResponseState> m_state;
+};
+
+#endif // HTTPDEFERREDRESPONSE_H
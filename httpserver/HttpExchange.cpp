@@ -0,0 +1,77 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include "HttpExchange.h"
+
+HttpExchange::HttpExchange()
+    : m_request(),
+      m_response(),
+      m_deferred()
+{
+}
+
+HttpExchange::HttpExchange(HttpRequest &&request, HttpResponse &&response, const HttpDeferredResponse &deferred)
+    : m_request(std::move(request)),
+      m_response(std::move(response)),
+      m_deferred(deferred)
+{
+    // Only finish() may complete the response, and the socket
+    // belongs to the connection's thread: keep what is sent until then.
+    m_response.m_pClientHandler = nullptr;
+    m_response.detach();
+}
+
+HttpExchange::HttpExchange(HttpExchange &&exchange) noexcept
+    : m_request(std::move(exchange.m_request)),
+      m_response(std::move(exchange.m_response)),
+      m_deferred(exchange.m_deferred)
+{
+    exchange.m_deferred = HttpDeferredResponse();
+}
+
+HttpExchange& HttpExchange::operator =(HttpExchange &&exchange) noexcept
+{
+    if (this != &exchange) {
+        m_request = std::move(exchange.m_request);
+        m_response = std::move(exchange.m_response);
+        m_deferred = exchange.m_deferred;
+        exchange.m_deferred = HttpDeferredResponse();
+    }
+    return *this;
+}
+
+bool HttpExchange::finish()
+{
+    if (m_deferred.isNull()) {
+        return false;
+    }
+
+    // The resolver may be copied, share the response instead.
+    QSharedPointer<HttpResponse> response(new HttpResponse(std::move(m_response)));
+    HttpDeferredResponse deferred = m_deferred;
+    m_deferred = HttpDeferredResponse();
+    m_request = HttpRequest();
+
+    // Called in the connection's thread
+    return deferred.resolve([response](HttpResponse &target) {
+        IHttpClientHandler *pClientHandler = target.m_pClientHandler;
+        QTcpSocket *pSocket = target.socket();
+        target = std::move(*response);
+        target.m_pClientHandler = pClientHandler;
+        target.attach(pSocket);
+    });
+}
@@ -0,0 +1,91 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPEXCHANGE_H
+#define HTTPEXCHANGE_H
+
+#include "HttpServerApi.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpDeferredResponse.h"
+
+/**
+ * Request/response pair taken out of a connection.
+ *
+ * Returned by HttpResponse::takeExchange(), the handle owns the request
+ * and the response, which were moved out of the client handler rather
+ * than copied. An asynchronous handler keeps the handle, fills in the
+ * response from any thread and calls finish() to hand the response back
+ * to the connection. The handle is move-only.
+ *
+ * The response held by the exchange is detached from the connection:
+ * finalize() and defer() have no effect on it, and data sent with
+ * send() or sendData() is buffered and written to the socket by finish()
+ * in the connection's thread. So a handler written for the connection's
+ * thread can fill it in from any thread.
+ *
+ * An exchange that is not finished within the route's timeout is
+ * answered with 504 Gateway Timeout, as a deferred response is.
+ */
+class HTTP_API HttpExchange
+{
+public:
+
+    /**
+     * Construct a null exchange.
+     */
+    HttpExchange();
+    HttpExchange(HttpExchange &&exchange) noexcept;
+    HttpExchange& operator =(HttpExchange &&exchange) noexcept;
+
+    bool isNull() const { return m_deferred.isNull(); }
+
+    const HttpRequest& request() const { return m_request; }
+    HttpRequest& request() { return m_request; }
+
+    const HttpResponse& response() const { return m_response; }
+    HttpResponse& response() { return m_response; }
+
+    /**
+     * Tells whether the connection still waits for the response.
+     * This method is thread-safe.
+     */
+    bool isPending() const { return m_deferred.isPending(); }
+
+    /**
+     * Hand the response back to the connection to be sent.
+     * The exchange becomes null.
+     * @return false if the exchange is null, has timed out
+     *         or the client has gone.
+     */
+    bool finish();
+
+private:
+
+    friend class HttpClientHandler;
+
+    HttpExchange(HttpRequest &&request, HttpResponse &&response, const HttpDeferredResponse &deferred);
+
+    HttpExchange(const HttpExchange&) = delete;
+    HttpExchange& operator =(const HttpExchange&) = delete;
+
+    HttpRequest m_request;
+    HttpResponse m_response;
+    HttpDeferredResponse m_deferred;    ///< Completion token.
+};
+
+#endif // HTTPEXCHANGE_H
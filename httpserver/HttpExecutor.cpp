@@ -0,0 +1,238 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <QThread>
+#include "HttpExecutor.h"
+
+/**
+ * Executor thread.
+ */
+class HttpExecutorThread : public QThread
+{
+public:
+
+    HttpExecutorThread(HttpExecutor *pExecutor, int index)
+        : QThread(),
+          m_pExecutor(pExecutor),
+          m_index(index)
+    {
+    }
+
+    HttpExecutor* executor() const { return m_pExecutor; }
+    int index() const { return m_index; }
+
+protected:
+
+    void run() override
+    {
+        m_pExecutor->run(m_index);
+    }
+
+private:
+
+    HttpExecutor *m_pExecutor;
+    int m_index;
+};
+
+HttpExecutor::HttpExecutor(int threadCount)
+    : m_threads(),
+      m_queues(),
+      m_injected(),
+      m_pending(0),
+      m_idleMutex(),
+      m_idle(),
+      m_sleeping(0),
+      m_stopping(0),
+      m_executed(0),
+      m_stolen(0)
+{
+    if (threadCount <= 0) {
+        threadCount = qMax(1, QThread::idealThreadCount());
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        m_queues.append(new Queue());
+        m_threads.append(new HttpExecutorThread(this, i));
+    }
+
+    foreach (QThread *pThread, m_threads) {
+        pThread->start();
+    }
+}
+
+HttpExecutor::~HttpExecutor()
+{
+    m_idleMutex.lock();
+    m_stopping.storeRelease(1);
+    m_idle.wakeAll();
+    m_idleMutex.unlock();
+
+    foreach (QThread *pThread, m_threads) {
+        pThread->wait();
+    }
+
+    qDeleteAll(m_threads);
+    qDeleteAll(m_queues);
+}
+
+HttpExecutor* HttpExecutor::instance()
+{
+    static HttpExecutor sExecutor;
+    return &sExecutor;
+}
+
+bool HttpExecutor::submit(const Task &task)
+{
+    Q_ASSERT(!task.isNull());
+
+    if (m_stopping.loadAcquire()) {
+        return false;
+    }
+
+    // Outside tasks are shared by all the threads
+    int index = currentIndex();
+    Queue *pQueue = index >= 0 ? m_queues.at(index) : &m_injected;
+    pQueue->mutex.lock();
+    pQueue->tasks.push_back(task);
+    pQueue->mutex.unlock();
+    m_pending.ref();
+
+    // Pairs with run(): either the task is seen by a thread going
+    // to sleep, or that thread is seen sleeping here. Both sides use
+    // ordered read-modify-writes, a plain load could be reordered.
+    if (m_sleeping.fetchAndAddOrdered(0) > 0) {
+        // The thread holds the mutex until it waits
+        QMutexLocker idleLocker(&m_idleMutex);
+        m_idle.wakeOne();
+    }
+
+    return true;
+}
+
+bool HttpExecutor::offload(HttpResponse &response, const Work &work)
+{
+    Q_ASSERT(!work.isNull());
+
+    HttpDeferredResponse deferred = response.defer();
+    if (deferred.isNull()) {
+        return false;
+    }
+
+    bool submitted = submit([deferred, work]() mutable {
+        if (!deferred.isPending()) {
+            // Nobody waits for the result any more
+            return;
+        }
+
+        HttpResponseResolver resolver = work();
+        if (resolver.isNull()) {
+            deferred.resolve(HttpResponse::InternalServerError);
+        } else {
+            deferred.resolve(resolver);
+        }
+    });
+
+    if (!submitted) {
+        deferred.resolve(HttpResponse::ServiceUnavailable);
+    }
+
+    return submitted;
+}
+
+int HttpExecutor::currentIndex() const
+{
+    HttpExecutorThread *pThread = dynamic_cast<HttpExecutorThread*>(QThread::currentThread());
+    if (pThread != nullptr && pThread->executor() == this) {
+        return pThread->index();
+    }
+    return -1;
+}
+
+bool HttpExecutor::pop(int index, Task *pTask)
+{
+    Queue *pQueue = m_queues.at(index);
+    QMutexLocker locker(&pQueue->mutex);
+    if (pQueue->tasks.empty()) {
+        return false;
+    }
+
+    // Newest task, likely still in the cache
+    *pTask = std::move(pQueue->tasks.back());
+    pQueue->tasks.pop_back();
+    return true;
+}
+
+bool HttpExecutor::popInjected(Task *pTask)
+{
+    QMutexLocker locker(&m_injected.mutex);
+    if (m_injected.tasks.empty()) {
+        return false;
+    }
+
+    // Oldest task first
+    *pTask = std::move(m_injected.tasks.front());
+    m_injected.tasks.pop_front();
+    return true;
+}
+
+bool HttpExecutor::steal(int index, Task *pTask)
+{
+    int count = m_queues.count();
+    for (int i = 1; i < count; i++) {
+        Queue *pQueue = m_queues.at((index + i) % count);
+        QMutexLocker locker(&pQueue->mutex);
+        if (!pQueue->tasks.empty()) {
+            // Oldest task, the owner works on the other end
+            *pTask = std::move(pQueue->tasks.front());
+            pQueue->tasks.pop_front();
+            m_stolen.ref();
+            return true;
+        }
+    }
+    return false;
+}
+
+void HttpExecutor::run(int index)
+{
+    Task task;
+    int count = 0;
+    for (;;) {
+        bool injectedFirst = ++count % InjectedCheckInterval == 0;
+        if ((injectedFirst && popInjected(&task)) || pop(index, &task)
+                || popInjected(&task) || steal(index, &task)) {
+            m_pending.deref();
+            task();
+            task.reset();
+            m_executed.ref();
+            continue;
+        }
+
+        QMutexLocker locker(&m_idleMutex);
+        m_sleeping.ref();
+        if (m_pending.fetchAndAddOrdered(0) > 0) {
+            // Queued while we were looking
+            m_sleeping.deref();
+            continue;
+        }
+        if (m_stopping.loadAcquire()) {
+            m_sleeping.deref();
+            break;
+        }
+        m_idle.wait(&m_idleMutex);
+        m_sleeping.deref();
+    }
+}
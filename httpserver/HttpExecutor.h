@@ -0,0 +1,161 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPEXECUTOR_H
+#define HTTPEXECUTOR_H
+
+#include <deque>
+#include <QAtomicInteger>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include "HttpServerApi.h"
+#include "HttpFunction.h"
+#include "HttpDeferredResponse.h"
+
+class QThread;
+
+/**
+ * Executor of CPU-bound work off the connection threads.
+ *
+ * Each executor thread has its own task deque. Tasks submitted from
+ * an executor thread go to its own deque and are taken back in LIFO
+ * order while still warm in the cache. Tasks submitted from other
+ * threads (e.g. offloaded requests) go to a shared queue and are run
+ * in FIFO order, so that the oldest requests are served first.
+ * A thread runs its own tasks, then the shared ones, then steals
+ * the oldest tasks from the other threads' deques before going
+ * to sleep; now and then it looks at the shared queue first,
+ * so that its own tasks cannot hold the shared ones back.
+ *
+ * A request handler offloads its work with offload(): the response
+ * is deferred, the connection's thread returns to its event loop,
+ * and the result is handed back through the deferred response.
+ * Long work should capture the request's cancellation token and
+ * check it now and then, to stop once the client has gone.
+ *
+ *     HttpCancellationToken cancellation = request.cancellation();
+ *     HttpExecutor::instance()->offload(response, [image, cancellation]() -> HttpResponseResolver {
+ *         QByteArray thumbnail = resize(image, cancellation);
+ *         return [thumbnail](HttpResponse &response) {
+ *             response.setStatus(HttpResponse::Ok);
+ *             response.setData(thumbnail);
+ *         };
+ *     });
+ */
+class HTTP_API HttpExecutor
+{
+public:
+
+    /// Task run by the executor.
+    typedef HttpFunction<void()> Task;
+
+    /**
+     * Offloaded part of a request handler.
+     * Runs in an executor thread and returns the function
+     * that fills in the response in the connection's thread.
+     */
+    typedef HttpFunction<HttpResponseResolver()> Work;
+
+    /**
+     * Construct an executor and start its threads.
+     * @param threadCount Number of threads, zero for one per CPU.
+     */
+    explicit HttpExecutor(int threadCount = 0);
+
+    /**
+     * Run the tasks still queued, then stop the threads.
+     */
+    ~HttpExecutor();
+
+    /**
+     * Executor shared by the application, with a thread per CPU.
+     * It is created on first use.
+     */
+    static HttpExecutor* instance();
+
+    int threadCount() const { return m_threads.count(); }
+
+    /**
+     * Queue a task.
+     * This method is thread-safe.
+     * @return false if the executor is being destroyed.
+     */
+    bool submit(const Task &task);
+
+    /**
+     * Run a request handler's work in the executor.
+     * Must be called from the request handler, in the connection's thread.
+     * The work is skipped if the request has timed out or the client
+     * has gone before it is started.
+     * @param response Response to be deferred and completed by the work.
+     * @param work Work to run; returning a null resolver answers
+     *        500 Internal Server Error.
+     * @return false if the response cannot be deferred or the
+     *         executor is being destroyed (the response is then
+     *         answered with 503 Service Unavailable).
+     */
+    bool offload(HttpResponse &response, const Work &work);
+
+    /// Number of tasks queued and not started yet.
+    int pendingCount() const { return m_pending.load(); }
+
+    /// Number of tasks run so far.
+    quint64 executedCount() const { return m_executed.load(); }
+
+    /// Number of tasks taken from another thread's deque.
+    quint64 stolenCount() const { return m_stolen.load(); }
+
+private:
+    Q_DISABLE_COPY(HttpExecutor)
+
+    friend class HttpExecutorThread;
+
+    /// Task deque of a thread.
+    struct Queue
+    {
+        QMutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    /// Index of the calling thread if it belongs to this executor, -1 otherwise.
+    int currentIndex() const;
+
+    bool pop(int index, Task *pTask);
+    bool popInjected(Task *pTask);
+    bool steal(int index, Task *pTask);
+
+    /// Body of executor thread.
+    void run(int index);
+
+    enum {
+        InjectedCheckInterval = 61  ///< Tasks run between checks of the shared queue first.
+    };
+
+    QList<QThread*> m_threads;
+    QList<Queue*> m_queues;             ///< Deques, one per thread.
+    Queue m_injected;                   ///< Tasks submitted from outside, FIFO.
+    QAtomicInt m_pending;               ///< Tasks queued.
+    QMutex m_idleMutex;
+    QWaitCondition m_idle;              ///< Signalled when tasks are queued.
+    QAtomicInt m_sleeping;              ///< Threads waiting for tasks.
+    QAtomicInt m_stopping;              ///< Whether the executor is being destroyed.
+    QAtomicInteger<quint64> m_executed;
+    QAtomicInteger<quint64> m_stolen;
+};
+
+#endif // HTTPEXECUTOR_H
@@ -0,0 +1,152 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <cstring>
+#include "HttpFieldTable.h"
+
+static inline char toLowerAscii(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+HttpFieldTable::HttpFieldTable(Qt::CaseSensitivity cs)
+    : m_arena(),
+      m_caseSensitivity(cs),
+      m_entries()
+{
+}
+
+void HttpFieldTable::add(const char *name, int nameSize, const char *value, int valueSize)
+{
+    int nameOffset = m_arena.append(name, nameSize);
+    if (nameOffset < 0) {
+        return;
+    }
+    int valueOffset = m_arena.append(value, valueSize);
+    if (valueOffset < 0) {
+        m_arena.truncate(nameOffset);
+        return;
+    }
+    addEntry(nameOffset, nameSize, valueOffset, valueSize);
+}
+
+void HttpFieldTable::add(const QString &name, const QString &value)
+{
+    QByteArray n = name.toUtf8();
+    QByteArray v = value.toUtf8();
+    add(n.constData(), n.size(), v.constData(), v.size());
+}
+
+void HttpFieldTable::addEntry(int nameOffset, int nameSize, int valueOffset, int valueSize)
+{
+    Entry entry;
+    entry.nameOffset = nameOffset;
+    entry.nameSize = nameSize;
+    entry.valueOffset = valueOffset;
+    entry.valueSize = valueSize;
+    m_entries.append(entry);
+}
+
+int HttpFieldTable::indexOf(const char *name, int size, int from) const
+{
+    for (int i = from; i < m_entries.count(); i++) {
+        if (matches(m_entries.at(i), name, size)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int HttpFieldTable::indexOf(const QString &name, int from) const
+{
+    const QChar *pName = name.constData();
+    const int size = name.size();
+    bool ascii = true;
+    for (int j = 0; j < size && ascii; j++) {
+        ascii = pName[j].unicode() < 0x80;
+    }
+    if (!ascii) {
+        QByteArray n = name.toUtf8();
+        return indexOf(n.constData(), n.size(), from);
+    }
+
+    // Compare ASCII names without converting them.
+    const bool sensitive = m_caseSensitivity == Qt::CaseSensitive;
+    for (int i = from; i < m_entries.count(); i++) {
+        const Entry &entry = m_entries.at(i);
+        if (entry.nameSize != size) {
+            continue;
+        }
+        const char *pField = m_arena.constData(entry.nameOffset);
+        int j = 0;
+        if (sensitive) {
+            while (j < size && pField[j] == static_cast<char>(pName[j].unicode())) {
+                j++;
+            }
+        } else {
+            while (j < size && toLowerAscii(pField[j]) == toLowerAscii(static_cast<char>(pName[j].unicode()))) {
+                j++;
+            }
+        }
+        if (j == size) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QString HttpFieldTable::value(const QString &name, const QString &defaultValue) const
+{
+    int i = indexOf(name);
+    return i >= 0 ? value(i) : defaultValue;
+}
+
+QStringList HttpFieldTable::values(const QString &name) const
+{
+    QStringList list;
+    int i = indexOf(name);
+    while (i >= 0) {
+        list.append(value(i));
+        i = indexOf(name, i + 1);
+    }
+    return list;
+}
+
+void HttpFieldTable::reset()
+{
+    m_arena.reset();
+    // Keeps the capacity
+    m_entries.resize(0);
+}
+
+bool HttpFieldTable::matches(const Entry &entry, const char *name, int size) const
+{
+    if (entry.nameSize != size) {
+        return false;
+    }
+
+    const char *pField = m_arena.constData(entry.nameOffset);
+    if (m_caseSensitivity == Qt::CaseSensitive) {
+        return std::memcmp(pField, name, size) == 0;
+    }
+
+    int j = 0;
+    while (j < size && toLowerAscii(pField[j]) == toLowerAscii(name[j])) {
+        j++;
+    }
+    return j == size;
+}
@@ -0,0 +1,122 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPFIELDTABLE_H
+#define HTTPFIELDTABLE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "HttpServerApi.h"
+#include "HttpArena.h"
+
+/**
+ * Table of name/value pairs stored in an arena.
+ *
+ * Raw (UTF-8) names and values are kept in the arena, the table
+ * only keeps their offsets. Repeated names are kept in order of
+ * appearance, lookups return the first match. Names and values
+ * are converted to QString only when requested.
+ *
+ * Base of HttpHeaders (names matched case-insensitively)
+ * and HttpArguments (names matched exactly).
+ */
+class HTTP_API HttpFieldTable
+{
+public:
+
+    explicit HttpFieldTable(Qt::CaseSensitivity cs);
+
+    /**
+     * Append a field.
+     * The field is dropped if the arena is full, see hasOverflowed().
+     */
+    void add(const char *name, int nameSize, const char *value, int valueSize);
+    void add(const QString &name, const QString &value);
+
+    int count() const { return m_entries.count(); }
+    bool isEmpty() const { return m_entries.isEmpty(); }
+
+    /// Raw name and value of i-th field.
+    const char* nameData(int i) const { return m_arena.constData(m_entries.at(i).nameOffset); }
+    int nameSize(int i) const { return m_entries.at(i).nameSize; }
+    const char* valueData(int i) const { return m_arena.constData(m_entries.at(i).valueOffset); }
+    int valueSize(int i) const { return m_entries.at(i).valueSize; }
+
+    QString name(int i) const { return QString::fromUtf8(nameData(i), nameSize(i)); }
+    QString value(int i) const { return QString::fromUtf8(valueData(i), valueSize(i)); }
+
+    /**
+     * Find a field.
+     * @param name Field name (UTF-8).
+     * @param size Name size.
+     * @param from Index to start searching from.
+     * @return Field index, or -1 if not found.
+     */
+    int indexOf(const char *name, int size, int from = 0) const;
+    int indexOf(const QString &name, int from = 0) const;
+
+    bool contains(const QString &name) const { return indexOf(name) >= 0; }
+
+    /**
+     * Get the value of the first field with the given name.
+     */
+    QString value(const QString &name, const QString &defaultValue = QString()) const;
+
+    /**
+     * Get values of all the fields with the given name.
+     */
+    QStringList values(const QString &name) const;
+
+    /**
+     * Remove all the fields, keeping the memory for reuse.
+     */
+    void reset();
+
+    /// Heap allocations made since the last reset.
+    int heapAllocations() const { return m_arena.heapAllocations(); }
+
+    /// Whether fields have been dropped since the last reset
+    /// because the arena reached HttpArena::MaxCapacity.
+    bool hasOverflowed() const { return m_arena.hasFailed(); }
+
+protected:
+
+    /**
+     * Append a field whose name and value are already in the arena.
+     */
+    void addEntry(int nameOffset, int nameSize, int valueOffset, int valueSize);
+
+    HttpArena m_arena;          ///< Names and values.
+
+private:
+
+    /// Field position in the arena.
+    struct Entry {
+        int nameOffset;
+        int nameSize;
+        int valueOffset;
+        int valueSize;
+    };
+
+    bool matches(const Entry &entry, const char *name, int size) const;
+
+    Qt::CaseSensitivity m_caseSensitivity;  ///< How names are matched.
+    QVector<Entry> m_entries;   ///< Fields.
+};
+
+#endif // HTTPFIELDTABLE_H
@@ -126,9 +126,22 @@ void HttpFileRequestHandler::serveFile(const QString &path,
     response.setOption(HttpOption::ContentLength, QString::number(fileInfo.size()));
     response.send();
 
+    /* Written to the socket, the loop blocks the connection's thread,
+     * so the request cannot be cancelled meanwhile: a gone client shows
+     * as the socket failing to flush. Served through an exchange (e.g.
+     * in a bulkhead) the output is buffered instead, and the connection's
+     * thread is free to cancel the request.
+     */
+    QTcpSocket *pSocket = response.socket();
     while (!file.atEnd()) {
+        if (pSocket != nullptr ? !response.isConnected() : request.isCancelled()) {
+            // Nobody to send the rest to
+            break;
+        }
         response.sendData(file.read(bufferSize));
-        response.socket()->flush();
+        if (pSocket != nullptr) {
+            pSocket->flush();
+        }
     }
 
     file.close();
@@ -0,0 +1,224 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPFUNCTION_H
+#define HTTPFUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <QtGlobal>
+
+template <typename Signature, int InlineSize = 4 * sizeof(void*)>
+class HttpFunction;
+
+/**
+ * Type-erased callable with small-buffer storage.
+ *
+ * Callables (function pointers, lambdas, functors) that fit into
+ * InlineSize bytes and can be moved without throwing are stored
+ * in place, so copying a route table or a queued task does not
+ * touch the heap. Bigger callables are allocated on the heap.
+ */
+template <typename R, typename... Args, int InlineSize>
+class HttpFunction<R(Args...), InlineSize>
+{
+    template <typename F, typename = void>
+    struct IsCallable : std::false_type {};
+
+    template <typename F>
+    struct IsCallable<F, decltype(void(std::declval<F&>()(std::declval<Args>()...)))>
+        : std::true_type {};
+
+    template <typename F>
+    struct IsAcceptable
+        : std::integral_constant<bool,
+            !std::is_same<typename std::decay<F>::type, HttpFunction>::value &&
+            IsCallable<typename std::decay<F>::type>::value> {};
+
+public:
+
+    HttpFunction()
+        : m_pOps(nullptr)
+    {
+    }
+
+    HttpFunction(std::nullptr_t)
+        : m_pOps(nullptr)
+    {
+    }
+
+    template <typename F, typename = typename std::enable_if<IsAcceptable<F>::value>::type>
+    HttpFunction(F &&f)
+        : m_pOps(nullptr)
+    {
+        typedef typename std::decay<F>::type Functor;
+        construct<Functor>(std::forward<F>(f), std::integral_constant<bool, isInline<Functor>()>());
+    }
+
+    HttpFunction(const HttpFunction &other)
+        : m_pOps(other.m_pOps)
+    {
+        if (m_pOps != nullptr) {
+            m_pOps->copy(&m_storage, &other.m_storage);
+        }
+    }
+
+    HttpFunction(HttpFunction &&other) noexcept
+        : m_pOps(other.m_pOps)
+    {
+        if (m_pOps != nullptr) {
+            m_pOps->move(&m_storage, &other.m_storage);
+            other.m_pOps = nullptr;
+        }
+    }
+
+    ~HttpFunction()
+    {
+        reset();
+    }
+
+    HttpFunction& operator =(const HttpFunction &other)
+    {
+        if (this != &other) {
+            HttpFunction tmp(other);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+
+    HttpFunction& operator =(HttpFunction &&other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            m_pOps = other.m_pOps;
+            if (m_pOps != nullptr) {
+                m_pOps->move(&m_storage, &other.m_storage);
+                other.m_pOps = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    R operator ()(Args... args) const
+    {
+        Q_ASSERT(m_pOps != nullptr);
+        return m_pOps->invoke(const_cast<Storage*>(&m_storage), std::forward<Args>(args)...);
+    }
+
+    bool isNull() const { return m_pOps == nullptr; }
+    explicit operator bool() const { return m_pOps != nullptr; }
+
+    /**
+     * Destroy the stored callable.
+     */
+    void reset()
+    {
+        if (m_pOps != nullptr) {
+            m_pOps->destroy(&m_storage);
+            m_pOps = nullptr;
+        }
+    }
+
+private:
+
+    union Storage {
+        void *pHeap;
+        typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type buffer;
+    };
+
+    /// Operations on the stored callable.
+    struct Ops {
+        R (*invoke)(Storage *pStorage, Args&&... args);
+        void (*copy)(Storage *pDst, const Storage *pSrc);
+        void (*move)(Storage *pDst, Storage *pSrc);
+        void (*destroy)(Storage *pStorage);
+    };
+
+    template <typename F>
+    static constexpr bool isInline()
+    {
+        return sizeof(F) <= sizeof(Storage) &&
+               alignof(F) <= alignof(Storage) &&
+               std::is_nothrow_move_constructible<F>::value;
+    }
+
+    /// Callable stored in the inline buffer.
+    template <typename F>
+    struct InlineOps
+    {
+        static F* get(Storage *p) { return reinterpret_cast<F*>(&p->buffer); }
+        static const F* get(const Storage *p) { return reinterpret_cast<const F*>(&p->buffer); }
+
+        static R invoke(Storage *p, Args&&... args) { return (*get(p))(std::forward<Args>(args)...); }
+        static void copy(Storage *pDst, const Storage *pSrc) { new (&pDst->buffer) F(*get(pSrc)); }
+        static void move(Storage *pDst, Storage *pSrc)
+        {
+            new (&pDst->buffer) F(std::move(*get(pSrc)));
+            get(pSrc)->~F();
+        }
+        static void destroy(Storage *p) { get(p)->~F(); }
+
+        static const Ops* ops()
+        {
+            static const Ops sOps = { &invoke, &copy, &move, &destroy };
+            return &sOps;
+        }
+    };
+
+    /// Callable allocated on the heap.
+    template <typename F>
+    struct HeapOps
+    {
+        static F* get(const Storage *p) { return static_cast<F*>(p->pHeap); }
+
+        static R invoke(Storage *p, Args&&... args) { return (*get(p))(std::forward<Args>(args)...); }
+        static void copy(Storage *pDst, const Storage *pSrc) { pDst->pHeap = new F(*get(pSrc)); }
+        static void move(Storage *pDst, Storage *pSrc)
+        {
+            pDst->pHeap = pSrc->pHeap;
+            pSrc->pHeap = nullptr;
+        }
+        static void destroy(Storage *p) { delete get(p); }
+
+        static const Ops* ops()
+        {
+            static const Ops sOps = { &invoke, &copy, &move, &destroy };
+            return &sOps;
+        }
+    };
+
+    template <typename F, typename T>
+    void construct(T &&f, std::true_type)
+    {
+        new (&m_storage.buffer) F(std::forward<T>(f));
+        m_pOps = InlineOps<F>::ops();
+    }
+
+    template <typename F, typename T>
+    void construct(T &&f, std::false_type)
+    {
+        m_storage.pHeap = new F(std::forward<T>(f));
+        m_pOps = HeapOps<F>::ops();
+    }
+
+    const Ops *m_pOps;  ///< Operations table, nullptr for empty function.
+    Storage m_storage;  ///< Inline buffer or pointer to heap-allocated callable.
+};
+
+#endif // HTTPFUNCTION_H
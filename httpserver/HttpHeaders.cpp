@@ -0,0 +1,53 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include "HttpHeaders.h"
+
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void trim(const char *&p, int &size)
+{
+    while (size > 0 && isSpace(*p)) {
+        ++p;
+        --size;
+    }
+    while (size > 0 && isSpace(p[size - 1])) {
+        --size;
+    }
+}
+
+HttpHeaders::HttpHeaders()
+    : HttpFieldTable(Qt::CaseInsensitive)
+{
+}
+
+void HttpHeaders::add(const char *name, int nameSize, const char *value, int valueSize)
+{
+    trim(name, nameSize);
+    trim(value, valueSize);
+    HttpFieldTable::add(name, nameSize, value, valueSize);
+}
+
+void HttpHeaders::add(const QString &name, const QString &value)
+{
+    QByteArray n = name.toUtf8();
+    QByteArray v = value.toUtf8();
+    add(n.constData(), n.size(), v.constData(), v.size());
+}
@@ -0,0 +1,46 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPHEADERS_H
+#define HTTPHEADERS_H
+
+#include <QString>
+#include "HttpServerApi.h"
+#include "HttpFieldTable.h"
+
+/**
+ * Request header fields as received.
+ *
+ * Raw names and values are stored in an arena (see HttpFieldTable).
+ * Names are matched case-insensitively and values are converted
+ * to QString only when requested.
+ */
+class HTTP_API HttpHeaders : public HttpFieldTable
+{
+public:
+
+    HttpHeaders();
+
+    /**
+     * Append a header field.
+     * Whitespace around the name and the value is dropped.
+     */
+    void add(const char *name, int nameSize, const char *value, int valueSize);
+    void add(const QString &name, const QString &value);
+};
+
+#endif // HTTPHEADERS_H
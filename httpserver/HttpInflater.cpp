@@ -0,0 +1,246 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <cstring>
+#include <zlib.h>
+#include <QList>
+#include <QThreadStorage>
+#include "HttpInflater.h"
+
+/// Per-thread pool of inflaters.
+class HttpInflaterPool
+{
+public:
+    ~HttpInflaterPool()
+    {
+        qDeleteAll(inflaters);
+    }
+
+    QList<HttpInflater*> inflaters;
+};
+
+static QThreadStorage<HttpInflaterPool*> sInflaterPool;
+
+HttpInflater::HttpInflater()
+    : m_pStream(new z_stream),
+      m_initialized(false),
+      m_encoding(Encoding_Identity),
+      m_prefixSize(0),
+      m_prefixOffset(0),
+      m_pending(false),
+      m_finished(false),
+      m_error(false)
+{
+}
+
+HttpInflater::~HttpInflater()
+{
+    z_stream *pStream = static_cast<z_stream*>(m_pStream);
+    if (m_initialized) {
+        inflateEnd(pStream);
+    }
+    delete pStream;
+}
+
+HttpInflater* HttpInflater::acquire(Encoding encoding)
+{
+    if (encoding != Encoding_Gzip && encoding != Encoding_Deflate) {
+        return nullptr;
+    }
+
+    HttpInflater *pInflater = nullptr;
+    if (sInflaterPool.hasLocalData() && !sInflaterPool.localData()->inflaters.isEmpty()) {
+        pInflater = sInflaterPool.localData()->inflaters.takeLast();
+    } else {
+        pInflater = new HttpInflater();
+    }
+
+    if (!pInflater->reset(encoding)) {
+        delete pInflater;
+        return nullptr;
+    }
+    return pInflater;
+}
+
+void HttpInflater::release(HttpInflater *pInflater)
+{
+    if (pInflater == nullptr) {
+        return;
+    }
+
+    if (!sInflaterPool.hasLocalData()) {
+        sInflaterPool.setLocalData(new HttpInflaterPool());
+    }
+
+    QList<HttpInflater*> &inflaters = sInflaterPool.localData()->inflaters;
+    if (inflaters.count() < MaxPooled) {
+        inflaters.append(pInflater);
+    } else {
+        delete pInflater;
+    }
+}
+
+HttpInflater::Encoding HttpInflater::encodingFromString(const QString &str)
+{
+    QString encoding = str.trimmed().toLower();
+    if (encoding.isEmpty() || encoding == "identity") {
+        return Encoding_Identity;
+    }
+    if (encoding == "gzip" || encoding == "x-gzip") {
+        return Encoding_Gzip;
+    }
+    if (encoding == "deflate") {
+        return Encoding_Deflate;
+    }
+    return Encoding_Unknown;
+}
+
+qint64 HttpInflater::inflate(const char *data, qint64 size, const char **ppOutput, qint64 *pOutputSize)
+{
+    Q_ASSERT(ppOutput != nullptr);
+    Q_ASSERT(pOutputSize != nullptr);
+
+    *ppOutput = m_buffer;
+    *pOutputSize = 0;
+
+    if (m_error || (m_finished && m_encoding != Encoding_Gzip)) {
+        // Anything after the end of the stream is ignored.
+        m_pending = false;
+        return size;
+    }
+
+    if (m_finished) {
+        if (size <= 0) {
+            m_pending = false;
+            return 0;
+        }
+        // Next member of a multi-member gzip body
+        m_finished = false;
+    }
+
+    qint64 taken = 0;
+    if (m_prefixSize < PrefixSize) {
+        // Keep the first bytes until the format is known
+        taken = qMin<qint64>(size, PrefixSize - m_prefixSize);
+        memcpy(m_prefix + m_prefixSize, data, static_cast<size_t>(taken));
+        m_prefixSize += static_cast<int>(taken);
+        if (m_prefixSize < PrefixSize) {
+            m_pending = false;
+            return taken;
+        }
+        if (!detectFormat()) {
+            m_pending = false;
+            m_error = true;
+            return taken;
+        }
+    }
+
+    // The kept bytes are inflated before the rest of the input
+    const bool fromPrefix = m_prefixOffset < m_prefixSize;
+    const char *pInput = fromPrefix ? m_prefix + m_prefixOffset : data + taken;
+    qint64 inputSize = fromPrefix ? m_prefixSize - m_prefixOffset : size - taken;
+
+    z_stream *pStream = static_cast<z_stream*>(m_pStream);
+    uInt available = inputSize > qint64(0x40000000) ? 0x40000000u : static_cast<uInt>(inputSize);
+    pStream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pInput));
+    pStream->avail_in = available;
+    pStream->next_out = reinterpret_cast<Bytef*>(m_buffer);
+    pStream->avail_out = BufferSize;
+
+    int res = ::inflate(pStream, Z_NO_FLUSH);
+
+    qint64 consumed = available - pStream->avail_in;
+    *pOutputSize = BufferSize - pStream->avail_out;
+
+    switch (res) {
+    case Z_OK:
+        m_pending = pStream->avail_out == 0;
+        break;
+    case Z_BUF_ERROR:
+        // No progress possible without more input
+        m_pending = false;
+        break;
+    case Z_STREAM_END:
+        m_pending = false;
+        m_finished = true;
+        if (m_encoding == Encoding_Gzip) {
+            // Another member may follow (RFC 1952, 2.2)
+            inflateReset(pStream);
+        }
+        break;
+    default:
+        m_pending = false;
+        m_error = true;
+        break;
+    }
+
+    if (fromPrefix) {
+        m_prefixOffset += static_cast<int>(consumed);
+        if (m_prefixOffset < m_prefixSize && !m_error && !m_finished) {
+            // Come back for the rest of the kept bytes
+            m_pending = true;
+        }
+        return taken;
+    }
+
+    return taken + consumed;
+}
+
+bool HttpInflater::detectFormat()
+{
+    if (m_encoding != Encoding_Deflate) {
+        return true;
+    }
+
+    // Some clients send raw deflate data instead of zlib format (RFC 1950):
+    // a zlib stream starts with a deflate method byte and a checksum.
+    uchar cmf = static_cast<uchar>(m_prefix[0]);
+    uchar flg = static_cast<uchar>(m_prefix[1]);
+    bool zlib = (cmf & 0x0f) == Z_DEFLATED && (cmf * 256 + flg) % 31 == 0;
+    if (zlib) {
+        return true;
+    }
+    return inflateReset2(static_cast<z_stream*>(m_pStream), -MAX_WBITS) == Z_OK;
+}
+
+bool HttpInflater::reset(Encoding encoding)
+{
+    z_stream *pStream = static_cast<z_stream*>(m_pStream);
+    int windowBits = encoding == Encoding_Gzip ? 16 + MAX_WBITS : MAX_WBITS;
+
+    if (!m_initialized) {
+        pStream->zalloc = Z_NULL;
+        pStream->zfree = Z_NULL;
+        pStream->opaque = Z_NULL;
+        pStream->next_in = Z_NULL;
+        pStream->avail_in = 0;
+        if (inflateInit2(pStream, windowBits) != Z_OK) {
+            return false;
+        }
+        m_initialized = true;
+    } else if (inflateReset2(pStream, windowBits) != Z_OK) {
+        return false;
+    }
+
+    m_encoding = encoding;
+    m_prefixSize = 0;
+    m_prefixOffset = 0;
+    m_pending = false;
+    m_finished = false;
+    m_error = false;
+    return true;
+}
@@ -0,0 +1,114 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPINFLATER_H
+#define HTTPINFLATER_H
+
+#include <QString>
+#include "HttpServerApi.h"
+
+/**
+ * Incremental decompressor of gzip and deflate content codings.
+ *
+ * zlib contexts are expensive to set up (the inflate window alone
+ * takes 32 KiB), so inflaters are pooled per thread: acquire() one
+ * for a request body and release() it once the body is received.
+ */
+class HTTP_API HttpInflater
+{
+public:
+
+    /// Content coding.
+    enum Encoding {
+        Encoding_Identity,  ///< No compression.
+        Encoding_Gzip,      ///< gzip (RFC 1952), members may be concatenated.
+        Encoding_Deflate,   ///< zlib (RFC 1950), raw deflate is tolerated.
+        Encoding_Unknown    ///< Unsupported coding.
+    };
+
+    ~HttpInflater();
+
+    /**
+     * Get an inflater from the calling thread's pool.
+     * @param encoding Content coding to decode.
+     * @return Inflater, or nullptr if zlib cannot be initialized.
+     */
+    static HttpInflater* acquire(Encoding encoding);
+
+    /**
+     * Return the inflater to the calling thread's pool.
+     */
+    static void release(HttpInflater *pInflater);
+
+    /**
+     * Map Content-Encoding header value to the coding.
+     */
+    static Encoding encodingFromString(const QString &str);
+
+    /**
+     * Decompress input data.
+     * The output is stored in the inflater's buffer and remains
+     * valid until the next call. Call repeatedly until all the input
+     * is consumed and hasPendingOutput() returns false.
+     * @param data Compressed data.
+     * @param size Compressed data size.
+     * @param ppOutput Set to decompressed data.
+     * @param pOutputSize Set to decompressed data size.
+     * @return Number of input bytes consumed.
+     */
+    qint64 inflate(const char *data, qint64 size, const char **ppOutput, qint64 *pOutputSize);
+
+    /// Whether output is pending for already consumed input.
+    bool hasPendingOutput() const { return m_pending; }
+
+    /// Whether the end of the compressed stream has been reached.
+    bool isFinished() const { return m_finished; }
+
+    bool hasError() const { return m_error; }
+
+private:
+
+    enum {
+        BufferSize = 16384,     ///< Output buffer size.
+        PrefixSize = 2,         ///< Bytes telling zlib from raw deflate.
+        MaxPooled = 4           ///< Inflaters kept per thread.
+    };
+
+    HttpInflater();
+    Q_DISABLE_COPY(HttpInflater)
+
+    bool reset(Encoding encoding);
+
+    /**
+     * Set the stream up for the format the kept prefix tells.
+     * @return false if zlib fails.
+     */
+    bool detectFormat();
+
+    void *m_pStream;    ///< zlib stream (z_stream).
+    bool m_initialized; ///< Whether the stream is initialized.
+    Encoding m_encoding;
+    char m_prefix[PrefixSize];  ///< First bytes of the body.
+    int m_prefixSize;   ///< Number of bytes kept in the prefix.
+    int m_prefixOffset; ///< Number of prefix bytes inflated.
+    bool m_pending;
+    bool m_finished;
+    bool m_error;
+    char m_buffer[BufferSize];
+};
+
+#endif // HTTPINFLATER_H
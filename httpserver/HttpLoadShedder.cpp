@@ -0,0 +1,87 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <QThreadStorage>
+#include <QTimer>
+#include "HttpRequest.h"
+#include "HttpLoadShedder.h"
+
+static QThreadStorage<HttpLoadShedder*> sLoadShedder;
+
+HttpLoadShedder* HttpLoadShedder::instance()
+{
+    if (!sLoadShedder.hasLocalData()) {
+        sLoadShedder.setLocalData(new HttpLoadShedder());
+    }
+    return sLoadShedder.localData();
+}
+
+HttpLoadShedder::HttpLoadShedder()
+    : QObject(),
+      m_clock(),
+      m_pProbeTimer(nullptr),
+      m_probeTime(0),
+      m_lag(0),
+      m_intervalEnd(0),
+      m_minDelay(-1),
+      m_overloaded(false),
+      m_shedLevel(0),
+      m_shedCount(0)
+{
+    m_clock.start();
+
+    m_pProbeTimer = new QTimer(this);
+    m_pProbeTimer->setInterval(ProbeInterval);
+    connect(m_pProbeTimer, SIGNAL(timeout()), this, SLOT(onProbe()));
+    m_pProbeTimer->start();
+    m_probeTime = now() + ProbeInterval;
+}
+
+bool HttpLoadShedder::admit(qint64 delay, int target, int interval, bool sheddable, int priority)
+{
+    delay += m_lag;
+
+    qint64 t = now();
+    if (t >= m_intervalEnd) {
+        // Standing queue if even the shortest delay was over the target
+        m_overloaded = m_minDelay > target;
+        if (m_overloaded) {
+            m_shedLevel = qMin(m_shedLevel + 1, static_cast<int>(HttpRequest::PriorityCount));
+        } else if (m_shedLevel > 0) {
+            m_shedLevel--;
+        }
+        m_minDelay = -1;
+        m_intervalEnd = t + interval;
+    }
+    if (m_minDelay < 0 || delay < m_minDelay) {
+        m_minDelay = delay;
+    }
+
+    qint64 limit = m_overloaded && priority < m_shedLevel ? target : interval;
+    if (sheddable && delay > limit) {
+        m_shedCount++;
+        return false;
+    }
+    return true;
+}
+
+void HttpLoadShedder::onProbe()
+{
+    qint64 t = now();
+    m_lag = t > m_probeTime ? static_cast<int>(t - m_probeTime) : 0;
+    m_probeTime = t + ProbeInterval;
+}
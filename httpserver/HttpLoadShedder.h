@@ -0,0 +1,108 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPLOADSHEDDER_H
+#define HTTPLOADSHEDDER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include "HttpServerApi.h"
+
+class QTimer;
+
+/**
+ * Latency-based load shedding.
+ *
+ * Each thread measures how late its event loop runs a periodic probe
+ * (the event loop lag). A request's queueing delay is the time from
+ * its last data being read to its handler being started, plus that lag.
+ *
+ * Requests are admitted in the CoDel fashion: if the smallest delay seen
+ * over an interval exceeds the target, the queue is standing rather than
+ * absorbing a burst, and requests delayed more than the target are shed
+ * until the delay falls back. Otherwise only requests delayed more than
+ * a whole interval are shed.
+ *
+ * Priority classes are shed in turn: the first overloaded interval
+ * sheds only the lowest class, and every further one extends shedding
+ * to the next class up. Each interval back under the target lowers
+ * the shedding level by one class again.
+ *
+ * There is one shedder per thread. Its methods are not thread-safe.
+ */
+class HTTP_API HttpLoadShedder : public QObject
+{
+    Q_OBJECT
+public:
+
+    enum {
+        ProbeInterval = 50  ///< Event loop lag probe period, ms.
+    };
+
+    /**
+     * Shedder of the current thread.
+     */
+    static HttpLoadShedder* instance();
+
+    /// Milliseconds elapsed on the shedder's clock.
+    qint64 now() const { return m_clock.elapsed(); }
+
+    /// Last measured event loop lag, ms.
+    int lag() const { return m_lag; }
+
+    /**
+     * Decide whether to handle a request.
+     * @param delay Time (ms) the request has waited since it was read.
+     * @param target Target queueing delay, ms.
+     * @param interval Interval (ms) over which the delay must stay
+     *                 above the target to shed requests.
+     * @param sheddable Whether the request may be shed; the delay
+     *                  of other requests is still accounted for.
+     * @param priority Priority class of the request (zero for the lowest).
+     * @return false if the request should be shed.
+     */
+    bool admit(qint64 delay, int target, int interval, bool sheddable = true, int priority = 0);
+
+    /// Whether the target delay is being exceeded.
+    bool isOverloaded() const { return m_overloaded; }
+
+    /// Number of the lowest priority classes being shed.
+    int shedLevel() const { return m_shedLevel; }
+
+    /// Number of requests shed on this thread.
+    quint64 shedCount() const { return m_shedCount; }
+
+private slots:
+
+    void onProbe();
+
+private:
+
+    HttpLoadShedder();
+
+    QElapsedTimer m_clock;
+    QTimer *m_pProbeTimer;
+    qint64 m_probeTime;     ///< When the probe is expected to fire.
+    int m_lag;              ///< Event loop lag, ms.
+    qint64 m_intervalEnd;   ///< End of the current interval.
+    qint64 m_minDelay;      ///< Smallest delay over the current interval.
+    bool m_overloaded;      ///< Whether the last interval was over the target.
+    int m_shedLevel;        ///< Priority classes below this one are shed.
+    quint64 m_shedCount;    ///< Requests shed.
+};
+
+#endif // HTTPLOADSHEDDER_H
@@ -0,0 +1,75 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include "HttpMiddleware.h"
+
+HttpMiddlewareNext::HttpMiddlewareNext(const HttpMiddlewareChain *pChain, int index)
+    : m_pChain(pChain),
+      m_index(index)
+{
+    Q_ASSERT(pChain != nullptr);
+}
+
+void HttpMiddlewareNext::operator ()(const HttpRequest &request, HttpResponse &response)
+{
+    m_pChain->invoke(m_index, request, response);
+}
+
+HttpMiddlewareChain::HttpMiddlewareChain()
+    : m_filters(),
+      m_handler()
+{
+}
+
+HttpMiddlewareChain::HttpMiddlewareChain(const HttpRequestFunction &handler)
+    : m_filters(),
+      m_handler(handler)
+{
+}
+
+HttpMiddlewareChain& HttpMiddlewareChain::append(const Filter &filter)
+{
+    Q_ASSERT(!filter.isNull());
+    m_filters.append(filter);
+    return *this;
+}
+
+HttpMiddlewareChain& HttpMiddlewareChain::prepend(const Filter &filter)
+{
+    Q_ASSERT(!filter.isNull());
+    m_filters.prepend(filter);
+    return *this;
+}
+
+void HttpMiddlewareChain::operator ()(const HttpRequest &request, HttpResponse &response) const
+{
+    invoke(0, request, response);
+}
+
+void HttpMiddlewareChain::invoke(int index, const HttpRequest &request, HttpResponse &response) const
+{
+    if (index < m_filters.count()) {
+        HttpMiddlewareNext next(this, index + 1);
+        m_filters.at(index)(request, response, next);
+    } else if (!m_handler.isNull()) {
+        m_handler(request, response);
+    } else {
+        // Chain without a handler
+        response.setStatus(HttpResponse::NotFound);
+        response.finalize();
+    }
+}
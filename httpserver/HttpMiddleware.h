@@ -0,0 +1,174 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPMIDDLEWARE_H
+#define HTTPMIDDLEWARE_H
+
+#include <type_traits>
+#include <utility>
+#include <QVector>
+#include "HttpServerApi.h"
+#include "HttpRequestHandler.h"
+
+/*
+ * Middleware filters.
+ *
+ * A filter is a callable of the form
+ *
+ *     template <typename Next>
+ *     void operator ()(const HttpRequest &request, HttpResponse &response, Next &next);
+ *
+ * It calls next(request, response) to pass the request down the chain.
+ * Not calling next short-circuits the chain (e.g. to reject a request
+ * with 401, in which case the filter finalizes the response itself),
+ * code placed after the call post-processes the response.
+ * Filters are shared between client threads and must be reentrant.
+ *
+ * httpPipeline() composes filters and a terminal handler into a single
+ * callable at compile time: every link knows the exact type of the next
+ * one, so the whole chain is inlined into one call. HttpMiddlewareChain
+ * does the same at run time for chains assembled dynamically.
+ */
+
+/**
+ * Link of a compile-time composed pipeline.
+ */
+template <typename Filter, typename Next>
+class HttpFilterLink
+{
+public:
+
+    HttpFilterLink(Filter filter, Next next)
+        : m_filter(std::move(filter)),
+          m_next(std::move(next))
+    {
+    }
+
+    void operator ()(const HttpRequest &request, HttpResponse &response)
+    {
+        m_filter(request, response, m_next);
+    }
+
+private:
+
+    Filter m_filter;    ///< This link's filter.
+    Next m_next;        ///< Rest of the pipeline.
+};
+
+template <typename... Stages>
+struct HttpPipelineBuilder;
+
+template <typename Handler>
+struct HttpPipelineBuilder<Handler>
+{
+    typedef Handler Type;
+
+    static Type make(Handler handler)
+    {
+        return handler;
+    }
+};
+
+template <typename Filter, typename... Rest>
+struct HttpPipelineBuilder<Filter, Rest...>
+{
+    typedef HttpFilterLink<Filter, typename HttpPipelineBuilder<Rest...>::Type> Type;
+
+    static Type make(Filter filter, Rest... rest)
+    {
+        return Type(std::move(filter), HttpPipelineBuilder<Rest...>::make(std::move(rest)...));
+    }
+};
+
+/**
+ * Compose filters and a request handler into a pipeline.
+ * The last argument is the handler, all preceding ones are filters
+ * applied in order. The result can be mapped with HttpRequestRouter::map().
+ * @param stages Filters followed by the handler.
+ * @return Pipeline callable.
+ */
+template <typename... Stages>
+typename HttpPipelineBuilder<typename std::decay<Stages>::type...>::Type
+httpPipeline(Stages&&... stages)
+{
+    return HttpPipelineBuilder<typename std::decay<Stages>::type...>::make(std::forward<Stages>(stages)...);
+}
+
+class HttpMiddlewareChain;
+
+/**
+ * Continuation passed to filters of a run-time chain.
+ */
+class HTTP_API HttpMiddlewareNext
+{
+public:
+
+    void operator ()(const HttpRequest &request, HttpResponse &response);
+
+private:
+
+    friend class HttpMiddlewareChain;
+
+    HttpMiddlewareNext(const HttpMiddlewareChain *pChain, int index);
+
+    const HttpMiddlewareChain *m_pChain;
+    int m_index;    ///< Index of the next filter to be called.
+};
+
+/**
+ * Run-time composed middleware chain.
+ * Each filter costs an indirect call; use httpPipeline()
+ * when the chain is known at compile time.
+ */
+class HTTP_API HttpMiddlewareChain
+{
+public:
+
+    typedef HttpFunction<void(const HttpRequest&, HttpResponse&, HttpMiddlewareNext&)> Filter;
+
+    HttpMiddlewareChain();
+    explicit HttpMiddlewareChain(const HttpRequestFunction &handler);
+
+    /**
+     * Append a filter to the end of the chain
+     * (i.e. closest to the handler).
+     */
+    HttpMiddlewareChain& append(const Filter &filter);
+
+    /**
+     * Insert a filter at the beginning of the chain.
+     */
+    HttpMiddlewareChain& prepend(const Filter &filter);
+
+    const HttpRequestFunction& handler() const { return m_handler; }
+    void setHandler(const HttpRequestFunction &handler) { m_handler = handler; }
+
+    int count() const { return m_filters.count(); }
+
+    void operator ()(const HttpRequest &request, HttpResponse &response) const;
+
+private:
+
+    friend class HttpMiddlewareNext;
+
+    void invoke(int index, const HttpRequest &request, HttpResponse &response) const;
+
+    QVector<Filter> m_filters;      ///< Filters in calling order.
+    HttpRequestFunction m_handler;  ///< Terminal handler.
+};
+
+#endif // HTTPMIDDLEWARE_H
@@ -0,0 +1,334 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <cstring>
+#include <QMap>
+#include "HttpMultipartParser.h"
+
+/**
+ * Parse parameters of Content-Disposition header:
+ * form-data; name="field"; filename="a;b.txt"
+ */
+static QMap<QString, QString> parseDispositionParameters(const QString &str)
+{
+    QMap<QString, QString> params;
+
+    int pos = str.indexOf(';');
+    while (pos >= 0) {
+        int eq = str.indexOf('=', pos + 1);
+        if (eq < 0) {
+            break;
+        }
+        QString name = str.mid(pos + 1, eq - pos - 1).trimmed().toLower();
+
+        int i = eq + 1;
+        while (i < str.length() && str.at(i) == ' ') {
+            i++;
+        }
+
+        QString value("");
+        if (i < str.length() && str.at(i) == '"') {
+            int end = str.indexOf('"', i + 1);
+            if (end < 0) {
+                end = str.length();
+            }
+            value += str.mid(i + 1, end - i - 1);
+            pos = str.indexOf(';', end);
+        } else {
+            pos = str.indexOf(';', i);
+            value += str.mid(i, pos < 0 ? -1 : pos - i).trimmed();
+        }
+
+        params[name] = value;
+    }
+
+    return params;
+}
+
+HttpMultipartPart::HttpMultipartPart()
+    : m_headers(),
+      m_name(),
+      m_fileName(),
+      m_contentType(),
+      m_body()
+{
+}
+
+void HttpMultipartPart::addHeader(const QString &name, const QString &value)
+{
+    m_headers.append(Header(name, value));
+}
+
+QString HttpMultipartPart::header(const QString &name) const
+{
+    foreach (const Header &header, m_headers) {
+        if (header.first.compare(name, Qt::CaseInsensitive) == 0) {
+            return header.second;
+        }
+    }
+    return QString();
+}
+
+HttpMultipartParser::HttpMultipartParser()
+    : m_state(State_Error),
+      m_delimiter(),
+      m_carry(),
+      m_spillThreshold(-1),
+      m_maxMemorySize(-1),
+      m_memorySize(0),
+      m_tooLarge(false),
+      m_partHandler(),
+      m_part(),
+      m_parts()
+{
+    reset(QByteArray());
+}
+
+void HttpMultipartParser::reset(const QByteArray &boundary)
+{
+    m_part = HttpMultipartPart();
+    m_parts.clear();
+    m_memorySize = 0;
+    m_tooLarge = false;
+
+    if (boundary.isEmpty()) {
+        m_delimiter.clear();
+        m_carry.clear();
+        m_state = State_Error;
+        return;
+    }
+
+    m_delimiter = "\r\n--" + boundary;
+
+    // Horspool shift table
+    const int length = m_delimiter.size();
+    for (int i = 0; i < 256; i++) {
+        m_skip[i] = length;
+    }
+    for (int i = 0; i < length - 1; i++) {
+        m_skip[static_cast<uchar>(m_delimiter.at(i))] = length - 1 - i;
+    }
+
+    // The first boundary is not preceded by CRLF
+    m_carry = "\r\n";
+    m_state = State_Preamble;
+}
+
+bool HttpMultipartParser::feed(const char *data, qint64 size)
+{
+    qint64 pos = 0;
+    while (pos < size) {
+        switch (m_state) {
+        case State_Preamble:
+        case State_Data:
+            pos += scanData(data + pos, size - pos);
+            break;
+        case State_Boundary: {
+            bool complete = false;
+            pos += readLine(data + pos, size - pos, &complete);
+            if (complete) {
+                if (m_carry.startsWith("--")) {
+                    // Closing boundary
+                    m_state = State_Epilogue;
+                } else if (m_carry.trimmed().isEmpty()) {
+                    beginPart();
+                } else {
+                    m_state = State_Error;
+                }
+                m_carry.clear();
+            }
+            break;
+        }
+        case State_Headers: {
+            bool complete = false;
+            pos += readLine(data + pos, size - pos, &complete);
+            if (complete) {
+                parseHeader();
+                m_carry.clear();
+            }
+            break;
+        }
+        case State_Epilogue:
+            // Ignore whatever follows
+            return true;
+        case State_Error:
+            return false;
+        }
+    }
+
+    return m_state != State_Error;
+}
+
+qint64 HttpMultipartParser::scanData(const char *data, qint64 size)
+{
+    const int length = m_delimiter.size();
+
+    if (!m_carry.isEmpty()) {
+        // The delimiter may start in the bytes carried over,
+        // look for it in those followed by the beginning of the input.
+        int carried = m_carry.size();
+        qint64 n = qMin<qint64>(size, length - 1);
+        m_carry.append(data, static_cast<int>(n));
+
+        qint64 pos = find(m_carry.constData(), m_carry.size());
+        if (pos >= 0) {
+            emitData(m_carry.constData(), pos);
+            m_carry.clear();
+            endPart();
+            return pos + length - carried;
+        }
+
+        if (n < length - 1) {
+            // Input is exhausted, keep what may start the delimiter.
+            int keep = qMin(m_carry.size(), length - 1);
+            emitData(m_carry.constData(), m_carry.size() - keep);
+            m_carry.remove(0, m_carry.size() - keep);
+            return n;
+        }
+
+        // No delimiter starts in the carried bytes.
+        emitData(m_carry.constData(), carried);
+        m_carry.clear();
+    }
+
+    qint64 pos = find(data, size);
+    if (pos >= 0) {
+        emitData(data, pos);
+        endPart();
+        return pos + length;
+    }
+
+    qint64 keep = qMin<qint64>(size, length - 1);
+    emitData(data, size - keep);
+    m_carry.append(data + size - keep, static_cast<int>(keep));
+    return size;
+}
+
+qint64 HttpMultipartParser::readLine(const char *data, qint64 size, bool *pComplete)
+{
+    const char *pEol = static_cast<const char*>(std::memchr(data, '\n', size));
+    qint64 n = pEol != nullptr ? pEol - data + 1 : size;
+    if (m_carry.size() + n > MaxLineLength) {
+        m_state = State_Error;
+        return n;
+    }
+    m_carry.append(data, static_cast<int>(n));
+    *pComplete = pEol != nullptr;
+    return n;
+}
+
+void HttpMultipartParser::parseHeader()
+{
+    QString line = QString::fromUtf8(m_carry);
+
+    if (line.trimmed().isEmpty()) {
+        // Headers are over
+        m_part.m_body.setSpillThreshold(m_spillThreshold);
+        if (!m_partHandler.isNull()) {
+            m_partHandler(m_part);
+        }
+        m_state = State_Data;
+        return;
+    }
+
+    if (m_part.m_headers.count() >= MaxHeaders) {
+        m_state = State_Error;
+        return;
+    }
+
+    int pos = line.indexOf(':');
+    if (pos <= 0) {
+        m_state = State_Error;
+        return;
+    }
+
+    QString name = line.left(pos).trimmed();
+    QString value = line.mid(pos + 1).trimmed();
+    m_part.addHeader(name, value);
+
+    if (name.compare("Content-Disposition", Qt::CaseInsensitive) == 0) {
+        QMap<QString, QString> params = parseDispositionParameters(value);
+        m_part.m_name = params.value("name");
+        if (params.contains("filename")) {
+            m_part.m_fileName = params.value("filename");
+        }
+    } else if (name.compare("Content-Type", Qt::CaseInsensitive) == 0) {
+        m_part.m_contentType = HttpContentType(value);
+    }
+}
+
+qint64 HttpMultipartParser::find(const char *data, qint64 size) const
+{
+    const uchar *p = reinterpret_cast<const uchar*>(data);
+    const uchar *pDelimiter = reinterpret_cast<const uchar*>(m_delimiter.constData());
+    const int length = m_delimiter.size();
+    const uchar last = pDelimiter[length - 1];
+
+    qint64 pos = 0;
+    while (pos + length <= size) {
+        uchar c = p[pos + length - 1];
+        if (c == last && std::memcmp(p + pos, pDelimiter, length - 1) == 0) {
+            return pos;
+        }
+        pos += m_skip[c];
+    }
+
+    return -1;
+}
+
+void HttpMultipartParser::emitData(const char *data, qint64 size)
+{
+    if (m_state != State_Data || size <= 0) {
+        // Preamble is discarded
+        return;
+    }
+
+    HttpRequestBody &body = m_part.m_body;
+    if (!body.append(data, size)) {
+        m_state = State_Error;
+        return;
+    }
+
+    if (m_maxMemorySize >= 0 && !body.isSpilled() && body.consumer().isNull() &&
+            m_memorySize + body.size() > m_maxMemorySize) {
+        m_tooLarge = true;
+        m_state = State_Error;
+    }
+}
+
+void HttpMultipartParser::beginPart()
+{
+    m_part = HttpMultipartPart();
+    m_state = State_Headers;
+}
+
+void HttpMultipartParser::endPart()
+{
+    if (m_state == State_Error) {
+        return;
+    }
+
+    if (m_state == State_Data) {
+        const HttpRequestBody &body = m_part.m_body;
+        if (!body.isSpilled() && body.consumer().isNull()) {
+            m_memorySize += body.size();
+        }
+        m_parts.append(m_part);
+        m_part = HttpMultipartPart();
+    }
+    m_state = State_Boundary;
+}
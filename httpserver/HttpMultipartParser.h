@@ -0,0 +1,177 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPMULTIPARTPARSER_H
+#define HTTPMULTIPARTPARSER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include "HttpServerApi.h"
+#include "HttpContentType.h"
+#include "HttpRequestBody.h"
+#include "HttpFunction.h"
+
+/**
+ * Part of a multipart/form-data body.
+ * The part content is stored the same way as a request body:
+ * in memory, or in a temporary file once it grows large.
+ */
+class HTTP_API HttpMultipartPart
+{
+public:
+
+    /// Part header (name, value).
+    typedef QPair<QString, QString> Header;
+
+    HttpMultipartPart();
+
+    const QList<Header>& headers() const { return m_headers; }
+    void addHeader(const QString &name, const QString &value);
+
+    /**
+     * Get header value.
+     * @param name Header name (case-insensitive).
+     * @return Header value, or empty string if not present.
+     */
+    QString header(const QString &name) const;
+
+    /// Form field name (from Content-Disposition).
+    QString name() const { return m_name; }
+
+    /// Uploaded file name, null string for regular fields.
+    QString fileName() const { return m_fileName; }
+
+    bool isFile() const { return !m_fileName.isNull(); }
+
+    const HttpContentType& contentType() const { return m_contentType; }
+
+    const HttpRequestBody& body() const { return m_body; }
+    HttpRequestBody& body() { return m_body; }
+
+private:
+
+    friend class HttpMultipartParser;
+
+    QList<Header> m_headers;        ///< Part headers.
+    QString m_name;                 ///< Field name.
+    QString m_fileName;             ///< File name (if a file).
+    HttpContentType m_contentType;  ///< Part content type.
+    HttpRequestBody m_body;         ///< Part content.
+};
+
+/**
+ * Incremental multipart/form-data parser.
+ *
+ * The body is fed in pieces as it is received. Boundaries are located
+ * with Boyer-Moore-Horspool search over the input itself; only the few
+ * bytes that may start a boundary are carried over between pieces.
+ * Part content is copied once, into the part's storage.
+ */
+class HTTP_API HttpMultipartParser
+{
+public:
+
+    /**
+     * Function called once a part's headers are parsed.
+     * It may install a consumer on the part's body to receive
+     * the content as it arrives (see HttpRequestBody::setConsumer()).
+     */
+    typedef HttpFunction<void(HttpMultipartPart&)> PartHandler;
+
+    HttpMultipartParser();
+
+    /**
+     * Start parsing a new body.
+     * @param boundary Boundary (from the content type parameter).
+     */
+    void reset(const QByteArray &boundary);
+
+    /**
+     * Size above which the content of a part is stored in a temporary
+     * file (see HttpRequestBody). Negative value keeps parts in memory.
+     */
+    qint64 spillThreshold() const { return m_spillThreshold; }
+    void setSpillThreshold(qint64 size) { m_spillThreshold = size; }
+
+    /**
+     * Limit (in bytes) of part content kept in memory, over all the parts.
+     * Exceeding it is an error (see isTooLarge()).
+     * Negative value means no limit.
+     */
+    qint64 maxMemorySize() const { return m_maxMemorySize; }
+    void setMaxMemorySize(qint64 size) { m_maxMemorySize = size; }
+
+    const PartHandler& partHandler() const { return m_partHandler; }
+    void setPartHandler(const PartHandler &handler) { m_partHandler = handler; }
+
+    /**
+     * Parse a piece of the body.
+     * @return false if the body is malformed.
+     */
+    bool feed(const char *data, qint64 size);
+
+    /// Whether the closing boundary has been reached.
+    bool isFinished() const { return m_state == State_Epilogue; }
+
+    bool hasError() const { return m_state == State_Error; }
+
+    /// Whether the error is due to parts exceeding the memory limit.
+    bool isTooLarge() const { return m_tooLarge; }
+
+    /// Parts parsed so far.
+    const QList<HttpMultipartPart>& parts() const { return m_parts; }
+
+private:
+
+    enum State {
+        State_Preamble,     ///< Before the first boundary.
+        State_Boundary,     ///< Rest of the boundary line.
+        State_Headers,      ///< Part headers.
+        State_Data,         ///< Part content.
+        State_Epilogue,     ///< After the closing boundary.
+        State_Error         ///< Malformed body.
+    };
+
+    enum {
+        MaxLineLength = 4096,   ///< Longest boundary or header line.
+        MaxHeaders = 32         ///< Maximum number of part headers.
+    };
+
+    qint64 scanData(const char *data, qint64 size);
+    qint64 readLine(const char *data, qint64 size, bool *pComplete);
+    void parseHeader();
+    qint64 find(const char *data, qint64 size) const;
+    void emitData(const char *data, qint64 size);
+    void beginPart();
+    void endPart();
+
+    State m_state;
+    QByteArray m_delimiter;     ///< CRLF, "--" and the boundary.
+    int m_skip[256];            ///< Horspool shift table.
+    QByteArray m_carry;         ///< Unprocessed input.
+    qint64 m_spillThreshold;    ///< Part spill threshold.
+    qint64 m_maxMemorySize;     ///< Limit of part content kept in memory.
+    qint64 m_memorySize;        ///< Content of the parsed parts kept in memory.
+    bool m_tooLarge;            ///< The memory limit has been exceeded.
+    PartHandler m_partHandler;
+    HttpMultipartPart m_part;           ///< Part being parsed.
+    QList<HttpMultipartPart> m_parts;   ///< Parsed parts.
+};
+
+#endif // HTTPMULTIPARTPARSER_H
@@ -26,6 +26,7 @@ const QString HttpOption::AcceptLanguage("Accept-Language");
 const QString HttpOption::Authorization("Authorization");
 const QString HttpOption::CacheControl("Cache-Control");
 const QString HttpOption::Connection("Connection");
+const QString HttpOption::ContentEncoding("Content-Encoding");
 const QString HttpOption::Cookie("Cookie");
 const QString HttpOption::ContentLength("Content-Length");
 const QString HttpOption::ContentLocation("Content-Location");
@@ -40,6 +41,8 @@ const QString HttpOption::IfModifiedSince("If-Modified-Since");
 const QString HttpOption::IfUnmodifiedSince("If-Unmodified-Since");
 const QString HttpOption::IfRange("If-Range");
 const QString HttpOption::Range("Range");
+const QString HttpOption::RetryAfter("Retry-After");
+const QString HttpOption::TransferEncoding("Transfer-Encoding");
 const QString HttpOption::UserAgent("UserAgent");
 
 const QRegExp cRegExpAscTime("(?:\\w{3})\\s+"   // Day of week (not captured)
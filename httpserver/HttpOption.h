@@ -36,6 +36,7 @@ public:
     const static QString Authorization;
     const static QString CacheControl;
     const static QString Connection;
+    const static QString ContentEncoding;
     const static QString Cookie;
     const static QString ContentLength;
     const static QString ContentLocation;
@@ -50,6 +51,8 @@ public:
     const static QString IfUnmodifiedSince;
     const static QString IfRange;
     const static QString Range;
+    const static QString RetryAfter;
+    const static QString TransferEncoding;
     const static QString UserAgent;
 
     static QDateTime asctimeToDateTime(const QString &str);
@@ -54,10 +54,17 @@ HttpRequest::HttpRequest()
       m_majorVersion(1),
       m_minorVersion(1),
       m_contentType(),
+      m_headers(),
+      m_rawArguments(),
       m_arguments(),
-      m_options(),
       m_cookies(),
-      m_data()
+      m_cookiesParsed(false),
+      m_body(),
+      m_parts(),
+      m_routeToken(0),
+      m_sheddable(true),
+      m_priority(Priority_Normal),
+      m_cancellation()
 {
 }
 
@@ -67,10 +74,17 @@ HttpRequest::HttpRequest(Method method, const QString &uri, int major, int minor
       m_majorVersion(major),
       m_minorVersion(minor),
       m_contentType(),
+      m_headers(),
+      m_rawArguments(),
       m_arguments(),
-      m_options(),
       m_cookies(),
-      m_data()
+      m_cookiesParsed(false),
+      m_body(),
+      m_parts(),
+      m_routeToken(0),
+      m_sheddable(true),
+      m_priority(Priority_Normal),
+      m_cancellation()
 {
 }
 
@@ -80,10 +94,17 @@ HttpRequest::HttpRequest(const HttpRequest &req)
       m_majorVersion(req.m_majorVersion),
       m_minorVersion(req.m_minorVersion),
       m_contentType(req.m_contentType),
+      m_headers(req.m_headers),
+      m_rawArguments(req.m_rawArguments),
       m_arguments(req.m_arguments),
-      m_options(req.m_options),
       m_cookies(req.m_cookies),
-      m_data(req.m_data)
+      m_cookiesParsed(req.m_cookiesParsed),
+      m_body(req.m_body),
+      m_parts(req.m_parts),
+      m_routeToken(req.m_routeToken),
+      m_sheddable(req.m_sheddable),
+      m_priority(req.m_priority),
+      m_cancellation(req.m_cancellation)
 {
 }
 
@@ -95,58 +116,170 @@ HttpRequest& HttpRequest::operator =(const HttpRequest &req)
         m_majorVersion = req.m_majorVersion;
         m_minorVersion = req.m_minorVersion;
         m_contentType = req.m_contentType;
+        m_headers = req.m_headers;
+        m_rawArguments = req.m_rawArguments;
         m_arguments = req.m_arguments;
-        m_options = req.m_options;
         m_cookies = req.m_cookies;
-        m_data = req.m_data;
+        m_cookiesParsed = req.m_cookiesParsed;
+        m_body = req.m_body;
+        m_parts = req.m_parts;
+        m_routeToken = req.m_routeToken;
+        m_sheddable = req.m_sheddable;
+        m_priority = req.m_priority;
+        m_cancellation = req.m_cancellation;
     }
     return *this;
 }
 
-void HttpRequest::addArgument(const QString &name, const QVariant &value)
+HttpRequest::HttpRequest(HttpRequest &&req) noexcept
+    : m_method(req.m_method),
+      m_uri(std::move(req.m_uri)),
+      m_majorVersion(req.m_majorVersion),
+      m_minorVersion(req.m_minorVersion),
+      m_contentType(req.m_contentType),
+      m_headers(std::move(req.m_headers)),
+      m_rawArguments(std::move(req.m_rawArguments)),
+      m_arguments(std::move(req.m_arguments)),
+      m_cookies(std::move(req.m_cookies)),
+      m_cookiesParsed(req.m_cookiesParsed),
+      m_body(std::move(req.m_body)),
+      m_parts(std::move(req.m_parts)),
+      m_routeToken(req.m_routeToken),
+      m_sheddable(req.m_sheddable),
+      m_priority(req.m_priority),
+      m_cancellation(std::move(req.m_cancellation))
 {
-    m_arguments[name] = value;
+    req.m_method = Method_Invalid;
+    req.m_cookiesParsed = false;
+    req.m_routeToken = 0;
 }
 
-void HttpRequest::parseArguments(const QString &str)
+HttpRequest& HttpRequest::operator =(HttpRequest &&req) noexcept
 {
-    QStringList args = str.split("&", QString::SkipEmptyParts);
-    foreach (const QString &arg, args) {
-        QStringList keyValue = arg.split("=", QString::KeepEmptyParts);
-        if (keyValue.count() == 2) {
-            QString key = keyValue.at(0);
-            QString value = QString(QByteArray::fromPercentEncoding(keyValue.at(1).toUtf8()));
-            addArgument(key, value);
-        }
+    if (this != &req) {
+        m_method = req.m_method;
+        m_uri = std::move(req.m_uri);
+        m_majorVersion = req.m_majorVersion;
+        m_minorVersion = req.m_minorVersion;
+        m_contentType = req.m_contentType;
+        m_headers = std::move(req.m_headers);
+        m_rawArguments = std::move(req.m_rawArguments);
+        m_arguments = std::move(req.m_arguments);
+        m_cookies = std::move(req.m_cookies);
+        m_cookiesParsed = req.m_cookiesParsed;
+        m_body = std::move(req.m_body);
+        m_parts = std::move(req.m_parts);
+        m_routeToken = req.m_routeToken;
+        m_sheddable = req.m_sheddable;
+        m_priority = req.m_priority;
+        m_cancellation = std::move(req.m_cancellation);
+        req.m_method = Method_Invalid;
+        req.m_cookiesParsed = false;
+        req.m_routeToken = 0;
+    }
+    return *this;
+}
+
+void HttpRequest::reset()
+{
+    m_method = Method_Invalid;
+    m_uri.clear();
+    m_majorVersion = 1;
+    m_minorVersion = 1;
+    m_contentType = HttpContentType();
+    m_headers.reset();
+    m_rawArguments.clear();
+    m_arguments.reset();
+    m_cookies.reset();
+    m_cookiesParsed = false;
+    m_body.clear();
+    m_parts.clear();
+    m_routeToken = 0;
+    m_sheddable = true;
+    m_priority = Priority_Normal;
+    m_cancellation = HttpCancellationToken();
+}
+
+const HttpCancellationToken& HttpRequest::cancellation() const
+{
+    if (m_cancellation.isNull()) {
+        m_cancellation = HttpCancellationToken::create();
+    }
+    return m_cancellation;
+}
+
+void HttpRequest::addArgument(const QString &name, const QString &value)
+{
+    // Keep the order of arguments
+    arguments().add(name, value);
+}
+
+void HttpRequest::parseArguments(const QByteArray &str)
+{
+    if (!m_rawArguments.isEmpty()) {
+        m_rawArguments.append('&');
+    }
+    m_rawArguments.append(str);
+}
+
+const HttpArguments& HttpRequest::arguments() const
+{
+    if (!m_rawArguments.isEmpty()) {
+        m_arguments.parse(m_rawArguments);
+        m_rawArguments.clear();
     }
+    return m_arguments;
 }
 
-void HttpRequest::addCookie(const QNetworkCookie &cookie)
+HttpArguments& HttpRequest::arguments()
 {
-    // TODO: Check coockie name corresponds to session holder
-    if (cookie.name() == "HttpSession::cookieName") {
-        //setSessionUid(QString(QByteArray::fromPersentEncoding(cookie.value())));
-    } else {
-        m_cookies.insert(cookie.name(), cookie);
+    static_cast<const HttpRequest*>(this)->arguments();
+    return m_arguments;
+}
+
+const HttpArguments& HttpRequest::cookies() const
+{
+    if (!m_cookiesParsed) {
+        static const QByteArray cookieName("Cookie");
+        int i = m_headers.indexOf(cookieName.constData(), cookieName.size());
+        while (i >= 0) {
+            m_cookies.parseCookies(m_headers.valueData(i), m_headers.valueSize(i));
+            i = m_headers.indexOf(cookieName.constData(), cookieName.size(), i + 1);
+        }
+        m_cookiesParsed = true;
     }
+    return m_cookies;
 }
 
-void HttpRequest::parseCookie(const QString &cookieString)
+void HttpRequest::addHeader(const char *name, int nameSize, const char *value, int valueSize)
 {
-    QList<QNetworkCookie> cookies = QNetworkCookie::parseCookies(cookieString.toLatin1());
-    foreach (const QNetworkCookie &cookie, cookies) {
-        addCookie(cookie);
+    m_headers.add(name, nameSize, value, valueSize);
+    if (m_cookiesParsed) {
+        // New Cookie header may have been added
+        m_cookiesParsed = false;
+        m_cookies.reset();
     }
 }
 
 void HttpRequest::addOption(const QString &name, const QVariant &value)
 {
-    m_options.insertMulti(name, value);
+    m_headers.add(name, value.toString());
+    if (m_cookiesParsed) {
+        // New Cookie header may have been added
+        m_cookiesParsed = false;
+        m_cookies.reset();
+    }
+}
+
+QVariant HttpRequest::option(const QString &name) const
+{
+    int i = m_headers.indexOf(name);
+    return i >= 0 ? QVariant(m_headers.value(i)) : QVariant();
 }
 
 void HttpRequest::appendData(const QByteArray &d)
 {
-    m_data.append(d);
+    m_body.append(d.constData(), d.size());
 }
 
 QString HttpRequest::toString() const
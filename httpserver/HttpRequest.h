@@ -19,12 +19,22 @@
 #define HTTPREQUEST_H
 
 #include <QString>
-#include <QVariantMap>
-#include <QMultiMap>
-#include <QNetworkCookie>
+#include <QVariant>
 #include "HttpServerApi.h"
 #include "HttpContentType.h"
-
+#include "HttpArguments.h"
+#include "HttpHeaders.h"
+#include "HttpRequestBody.h"
+#include "HttpMultipartParser.h"
+#include "HttpCancellationToken.h"
+
+/**
+ * HTTP request.
+ *
+ * Headers are kept as received; query arguments and cookies are
+ * parsed the first time they are accessed. Such accessors are const
+ * but not thread-safe: a request is handled by one thread at a time.
+ */
 class HTTP_API HttpRequest
 {
 public:
@@ -45,6 +55,16 @@ public:
         Method_Invalid     ///< Request is invalid.
     };
 
+    /// Priority class, from the lowest
+    enum Priority {
+        Priority_Low,       ///< Bulk traffic, shed first.
+        Priority_Normal,    ///< Default class.
+        Priority_High,      ///< Interactive traffic.
+        Priority_Critical,  ///< Health checks, admin calls; never shed.
+
+        PriorityCount
+    };
+
     /**
      * Construct an empty (invalid) request.
      */
@@ -54,6 +74,16 @@ public:
                 int major = 1, int minor = 1);
     HttpRequest(const HttpRequest& req);
     HttpRequest& operator =(const HttpRequest &req);
+    HttpRequest(HttpRequest &&req) noexcept;
+    HttpRequest& operator =(HttpRequest &&req) noexcept;
+
+    /**
+     * Make this an empty request again.
+     * Unlike assigning an empty request, the memory holding parsed
+     * headers, arguments and cookies is kept for the next request
+     * received on the connection.
+     */
+    void reset();
 
     Method method() const { return m_method; }
     void setMethod(Method m) { m_method = m; }
@@ -72,20 +102,96 @@ public:
     const HttpContentType& contentType() const { return m_contentType; }
     void setContentType(const HttpContentType &ct) { m_contentType = ct; }
 
-    void addArgument(const QString &name, const QVariant &value);
-    void parseArguments(const QString &str);
-    const QVariantMap& arguments() const { return m_arguments; }
-    QVariant argument(const QString &name) { return m_arguments.value(name); }
+    void addArgument(const QString &name, const QString &value);
+
+    /**
+     * Add url-encoded arguments (query string or form data).
+     * They are decoded when the arguments are first accessed.
+     * @param str Arguments as received (not decoded).
+     */
+    void parseArguments(const QByteArray &str);
+    const HttpArguments& arguments() const;
+    HttpArguments& arguments();
+    QString argument(const QString &name) const { return arguments().value(name); }
+
+    /**
+     * Cookies sent with the request (from Cookie headers).
+     */
+    const HttpArguments& cookies() const;
+    QString cookie(const QString &name) const { return cookies().value(name); }
 
-    void addCookie(const QNetworkCookie &cookie);
-    void parseCookie(const QString &cookieString);
+    /**
+     * Add a header field.
+     */
+    void addHeader(const char *name, int nameSize, const char *value, int valueSize);
+    const HttpHeaders& headers() const { return m_headers; }
 
     void addOption(const QString &name, const QVariant &value);
-    QVariant option(const QString &name) const { return m_options.value(name); }
 
-    const QByteArray& constData() const { return m_data; }
+    /**
+     * Get header field value.
+     * @param name Field name (case-insensitive).
+     * @return Value of the first field with this name,
+     *         invalid variant if not present.
+     */
+    QVariant option(const QString &name) const;
+
+    const QByteArray& constData() const { return m_body.data(); }
     void appendData(const QByteArray &d);
-    void setData(const QByteArray &d) { m_data = d; }
+    void setData(const QByteArray &d) { m_body.setData(d); }
+
+    /**
+     * Request body.
+     * Unlike constData() this also gives access to bodies
+     * spilled to disk (see HttpRequestBody).
+     */
+    const HttpRequestBody& body() const { return m_body; }
+    HttpRequestBody& body() { return m_body; }
+
+    /**
+     * Parts of a multipart/form-data request.
+     * Regular fields kept in memory are also available as arguments.
+     */
+    const QList<HttpMultipartPart>& parts() const { return m_parts; }
+    void addPart(const HttpMultipartPart &part) { m_parts.append(part); }
+
+    /**
+     * Token of the route resolved when the request headers were received
+     * (see HttpRequestRouter), zero if none.
+     */
+    quint64 routeToken() const { return m_routeToken; }
+    void setRouteToken(quint64 token) { m_routeToken = token; }
+
+    /**
+     * Whether the request may be shed under overload
+     * (see HttpRouteOptions::setSheddable()).
+     */
+    bool isSheddable() const { return m_sheddable; }
+    void setSheddable(bool v) { m_sheddable = v; }
+
+    /**
+     * Priority class of the request, set from its route
+     * (see HttpRouteOptions::setPriority()) or by the server's
+     * classifier (see HttpServerConfig::setPriorityClassifier()).
+     */
+    Priority priority() const { return m_priority; }
+    void setPriority(Priority p) { m_priority = p; }
+
+    /**
+     * Cancellation token of the request, cancelled when the client
+     * disconnects or the request times out. The token is created on
+     * first access; copies of it remain valid after the request is gone.
+     */
+    const HttpCancellationToken& cancellation() const;
+
+    /// Whether the request has been cancelled.
+    bool isCancelled() const { return m_cancellation.isCancelled(); }
+
+    /**
+     * Cancel the request (if its token has been created).
+     * @return false if nobody holds the token or it is cancelled already.
+     */
+    bool cancel(HttpCancellationToken::Reason reason) { return m_cancellation.cancel(reason); }
 
     QString toString() const;
 
@@ -99,10 +205,17 @@ private:
     int m_majorVersion;
     int m_minorVersion;
     HttpContentType m_contentType;
-    QVariantMap m_arguments;    ///< Arguments passed in request (POST or GET).
-    QMultiMap<QString, QVariant> m_options;     ///< Options.
-    QMap<QString, QNetworkCookie> m_cookies;    ///< Cookies.
-    QByteArray m_data;  ///< Data sent.
+    HttpHeaders m_headers;      ///< Header fields (options).
+    mutable QByteArray m_rawArguments;      ///< Arguments not decoded yet.
+    mutable HttpArguments m_arguments;      ///< Arguments passed in request (POST or GET).
+    mutable HttpArguments m_cookies;        ///< Cookies.
+    mutable bool m_cookiesParsed;           ///< Whether cookies have been parsed.
+    HttpRequestBody m_body;     ///< Data sent.
+    QList<HttpMultipartPart> m_parts;   ///< Multipart form parts.
+    quint64 m_routeToken;       ///< Resolved route.
+    bool m_sheddable;           ///< Whether the request may be shed.
+    Priority m_priority;        ///< Priority class.
+    mutable HttpCancellationToken m_cancellation;   ///< Cancellation token (created on demand).
 };
 
 #endif // HTTPREQUEST_H
@@ -0,0 +1,167 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <QDir>
+#include <QTemporaryFile>
+#include "HttpRequestBody.h"
+
+HttpRequestBody::HttpRequestBody()
+    : m_spillThreshold(-1),
+      m_size(0),
+      m_data(),
+      m_file(),
+      m_pMapped(nullptr),
+      m_consumer()
+{
+}
+
+bool HttpRequestBody::accepts(qint64 size) const
+{
+    if (!m_consumer.isNull() || isSpilled()) {
+        return true;
+    }
+
+    if (m_spillThreshold >= 0 && size > m_spillThreshold) {
+        // Will go to the temporary file
+        return true;
+    }
+
+    return size <= MaxMemorySize;
+}
+
+bool HttpRequestBody::reserve(qint64 size)
+{
+    if (!m_consumer.isNull()) {
+        // Nothing to be stored
+        return true;
+    }
+
+    if (!accepts(m_size + size)) {
+        return false;
+    }
+
+    if (m_spillThreshold >= 0 && m_size + size > m_spillThreshold) {
+        return spill();
+    }
+
+    if (!isSpilled()) {
+        // The size comes from the client, do not trust it with memory.
+        m_data.reserve(static_cast<int>(qMin<qint64>(m_size + size, MaxReservation)));
+    }
+    return true;
+}
+
+bool HttpRequestBody::append(const char *data, qint64 size)
+{
+    if (size <= 0) {
+        return true;
+    }
+
+    m_size += size;
+
+    if (!m_consumer.isNull()) {
+        m_consumer(data, size);
+        return true;
+    }
+
+    if (!isSpilled() && m_spillThreshold >= 0 && m_size > m_spillThreshold) {
+        if (!spill()) {
+            return false;
+        }
+    }
+
+    if (isSpilled()) {
+        return m_file->write(data, size) == size;
+    }
+
+    if (m_size > MaxMemorySize) {
+        return false;
+    }
+
+    m_data.append(data, static_cast<int>(size));
+    return true;
+}
+
+void HttpRequestBody::setData(const QByteArray &data)
+{
+    m_file.clear();
+    m_pMapped = nullptr;
+    m_data = data;
+    m_size = data.size();
+}
+
+QByteArray HttpRequestBody::readAll() const
+{
+    if (!isSpilled()) {
+        return m_data;
+    }
+
+    m_file->flush();
+    qint64 pos = m_file->pos();
+    m_file->seek(0);
+    QByteArray data = m_file->readAll();
+    m_file->seek(pos);
+    return data;
+}
+
+const uchar* HttpRequestBody::map()
+{
+    if (!isSpilled() || m_size == 0) {
+        return nullptr;
+    }
+
+    if (m_pMapped == nullptr) {
+        m_file->flush();
+        m_pMapped = m_file->map(0, m_size);
+    }
+    return m_pMapped;
+}
+
+QString HttpRequestBody::fileName() const
+{
+    return isSpilled() ? m_file->fileName() : QString();
+}
+
+void HttpRequestBody::clear()
+{
+    m_size = 0;
+    m_data.clear();
+    m_file.clear();
+    m_pMapped = nullptr;
+    m_consumer.reset();
+}
+
+bool HttpRequestBody::spill()
+{
+    if (isSpilled()) {
+        return true;
+    }
+
+    QSharedPointer<QTemporaryFile> file(new QTemporaryFile(QDir::tempPath() + "/qhttpserver-XXXXXX"));
+    if (!file->open()) {
+        return false;
+    }
+
+    // Move data received so far
+    if (!m_data.isEmpty() && file->write(m_data) != m_data.size()) {
+        return false;
+    }
+
+    m_file = file;
+    m_data = QByteArray();
+    return true;
+}
@@ -0,0 +1,141 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPREQUESTBODY_H
+#define HTTPREQUESTBODY_H
+
+#include <climits>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QString>
+#include "HttpServerApi.h"
+#include "HttpFunction.h"
+
+class QTemporaryFile;
+
+/**
+ * Body of an HTTP request.
+ *
+ * Small bodies are kept in memory. Once the body grows past
+ * the spill threshold (or is announced to do so by Content-Length)
+ * it is written to a temporary file instead, which can be read
+ * back or memory-mapped by the handler.
+ *
+ * Alternatively a handler may install a consumer when request
+ * headers are received: the body chunks are then passed to
+ * the consumer as they arrive and are not stored at all.
+ */
+class HTTP_API HttpRequestBody
+{
+public:
+
+    /// Function receiving body chunks.
+    typedef HttpFunction<void(const char *data, qint64 size)> Consumer;
+
+    HttpRequestBody();
+
+    /**
+     * Size (in bytes) above which the body is spilled to disk.
+     * Negative value keeps the body in memory regardless of its size.
+     */
+    qint64 spillThreshold() const { return m_spillThreshold; }
+    void setSpillThreshold(qint64 size) { m_spillThreshold = size; }
+
+    /**
+     * Tells whether a body of the given size can be stored.
+     * Bodies kept in memory cannot exceed MaxMemorySize.
+     */
+    bool accepts(qint64 size) const;
+
+    /**
+     * Prepare storage for the expected body size.
+     * Bodies that will not fit under the spill threshold
+     * go to the temporary file right away, memory reserved
+     * for the others is capped by MaxReservation.
+     * @param size Expected size (Content-Length).
+     * @return false if the body cannot be stored
+     *         or the temporary file cannot be created.
+     */
+    bool reserve(qint64 size);
+
+    /**
+     * Append a chunk to the body.
+     * @param data Chunk data.
+     * @param size Chunk size.
+     * @return false on temporary file write error
+     *         or if the body does not fit in memory.
+     */
+    bool append(const char *data, qint64 size);
+
+    /**
+     * Replace body content (keeping it in memory).
+     */
+    void setData(const QByteArray &data);
+
+    /**
+     * Body content if stored in memory, empty otherwise.
+     */
+    const QByteArray& data() const { return m_data; }
+
+    /**
+     * Read the whole body into memory.
+     */
+    QByteArray readAll() const;
+
+    /**
+     * Map spilled body into memory.
+     * The mapping remains valid as long as the body exists.
+     * @return Pointer to the mapped body, or nullptr if not spilled.
+     */
+    const uchar* map();
+
+    /// Number of bytes received so far.
+    qint64 size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+    /// Whether the body is stored in a temporary file.
+    bool isSpilled() const { return !m_file.isNull(); }
+
+    /// Name of the temporary file holding the body (if spilled).
+    QString fileName() const;
+
+    const Consumer& consumer() const { return m_consumer; }
+    void setConsumer(const Consumer &consumer) { m_consumer = consumer; }
+
+    /**
+     * Drop the body content and the consumer.
+     */
+    void clear();
+
+    enum {
+        MaxMemorySize = INT_MAX,            ///< Longest in-memory body.
+        MaxReservation = 1024 * 1024        ///< Most memory reserved upfront.
+    };
+
+private:
+
+    bool spill();
+
+    qint64 m_spillThreshold;    ///< Spill to disk above this size.
+    qint64 m_size;              ///< Body size.
+    QByteArray m_data;          ///< In-memory body.
+    QSharedPointer<QTemporaryFile> m_file;  ///< Spilled body.
+    const uchar *m_pMapped;     ///< Mapped spilled body.
+    Consumer m_consumer;        ///< Streaming consumer.
+};
+
+#endif // HTTPREQUESTBODY_H
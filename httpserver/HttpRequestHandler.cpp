@@ -22,6 +22,13 @@ HttpRequestHandler::HttpRequestHandler(QObject *pParent)
 {
 }
 
+bool HttpRequestHandler::handleRequestHeaders(HttpRequest &request, HttpResponse &response)
+{
+    Q_UNUSED(request);
+    Q_UNUSED(response);
+    return true;
+}
+
 void HttpRequestHandler::processRequest(const HttpRequest &request, HttpResponse &response)
 {
     handleRequest(request, response);
@@ -22,6 +22,26 @@
 #include "HttpServerApi.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
+#include "HttpDeferredResponse.h"
+#include "HttpFunction.h"
+
+/**
+ * Functional request handler.
+ * Lightweight alternative to HttpRequestHandler subclassing
+ * for plain functions and lambdas (see HttpRequestRouter::map).
+ */
+typedef HttpFunction<void(const HttpRequest&, HttpResponse&)> HttpRequestFunction;
+
+/**
+ * Functional counterpart of HttpRequestHandler::handleRequestHeaders().
+ */
+typedef HttpFunction<bool(HttpRequest&, HttpResponse&)> HttpRequestHeadersFunction;
+
+/**
+ * Function assigning a priority class to a request
+ * once its headers are received.
+ */
+typedef HttpFunction<HttpRequest::Priority(const HttpRequest&)> HttpPriorityClassifier;
 
 /**
  * Abstract handler of HTTP requests.
@@ -36,11 +56,26 @@ public:
 
     /**
      * Handle HTTP request.
+     * The handler must either finalize the response or defer it
+     * (see HttpResponse::defer()) before the response timeout.
      * @param request Incoming request.
      * @param response Generated response.
      */
     virtual void handleRequest(const HttpRequest &request, HttpResponse &response) = 0;
 
+    /**
+     * Handle HTTP request headers.
+     * Called once the headers are received, before the request body.
+     * A handler may install a body consumer here (see HttpRequestBody)
+     * to process the body as it arrives.
+     * @param request Request being received (without the body).
+     * @param response Response to be sent back.
+     * @return false to reject the request: the response is sent
+     *         with the status set by the handler (403 Forbidden if none)
+     *         and the body is not read.
+     */
+    virtual bool handleRequestHeaders(HttpRequest &request, HttpResponse &response);
+
 public slots:
 
     void processRequest(const HttpRequest &request, HttpResponse &response);
@@ -15,26 +15,42 @@
     Lesser General Public License for more details.
 */
 
+#include <QAtomicInteger>
+#include "HttpBulkhead.h"
 #include "HttpRequestRouter.h"
 
+/// Route tokens are unique across all routers.
+static QAtomicInteger<quint64> sNextToken(1);
+
 HttpRequestRouter::HttpRequestRouter(QObject *pParent)
     : HttpRequestHandler(pParent),
       m_mutex(),
-      m_handlers()
+      m_routes(),
+      m_bulkheads()
 {
 }
 
 HttpRequestRouter::~HttpRequestRouter()
 {
+    qDeleteAll(m_bulkheads);
 }
 
-HttpRequestRouter& HttpRequestRouter::map(const QRegExp &pattern, HttpRequestHandler *pHandler)
+HttpRequestRouter& HttpRequestRouter::map(const QRegExp &pattern,
+                                          HttpRequestHandler *pHandler,
+                                          const HttpRouteOptions &options)
 {
     Q_ASSERT(pHandler != nullptr);
 
     QMutexLocker locker(&m_mutex);
     if (pHandler != nullptr) {
-        m_handlers.append(PatternHandlerPair(pattern, pHandler));
+        Route route;
+        route.pattern = pattern;
+        route.pHandler = pHandler;
+        route.pGuard = HandlerGuardPtr(new HandlerGuard());
+        route.pGuard->pHandler = pHandler;
+        route.options = options;
+        route.token = nextToken();
+        m_routes.append(route);
         disconnect(pHandler, 0, this, 0);
         connect(pHandler, SIGNAL(destroyed(QObject*)), this, SLOT(onHandlerDeleted(QObject*)));
     }
@@ -45,72 +61,262 @@ HttpRequestRouter& HttpRequestRouter::unmap(HttpRequestHandler *pHandler)
 {
     Q_ASSERT(pHandler != nullptr);
 
-    QMutexLocker locker(&m_mutex);
+    QList<HandlerGuardPtr> guards;
     if (pHandler != nullptr) {
-        unmapUnsafe(pHandler);
+        QMutexLocker locker(&m_mutex);
+        guards = unmapUnsafe(pHandler);
     }
 
+    // Bulkheads may still run the handler
+    releaseGuards(guards);
     return *this;
 }
 
+HttpRequestRouter::Token HttpRequestRouter::map(const QRegExp &pattern,
+                                                const HttpRequestFunction &function,
+                                                const HttpRouteOptions &options)
+{
+    Q_ASSERT(!function.isNull());
+
+    QMutexLocker locker(&m_mutex);
+    if (function.isNull()) {
+        return 0;
+    }
+
+    Route route;
+    route.pattern = pattern;
+    route.pHandler = nullptr;
+    route.function = function;
+    route.options = options;
+    route.token = nextToken();
+    m_routes.append(route);
+
+    return route.token;
+}
+
+bool HttpRequestRouter::unmap(Token token)
+{
+    QMutexLocker locker(&m_mutex);
+
+    for (int i = 0; i < m_routes.count(); i++) {
+        if (m_routes.at(i).token == token) {
+            HttpRequestHandler *pHandler = m_routes.at(i).pHandler;
+            HandlerGuardPtr pGuard = m_routes.at(i).pGuard;
+            m_routes.remove(i);
+            if (pHandler != nullptr) {
+                // Stop watching the handler if it is not mapped anymore.
+                bool mapped = false;
+                foreach (const Route &route, m_routes) {
+                    mapped = mapped || route.pHandler == pHandler;
+                }
+                if (!mapped) {
+                    disconnect(pHandler, 0, this, 0);
+                }
+            }
+            locker.unlock();
+            if (!pGuard.isNull()) {
+                releaseGuards(QList<HandlerGuardPtr>() << pGuard);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void HttpRequestRouter::clear()
+{
+    QList<HandlerGuardPtr> guards;
+    {
+        QMutexLocker locker(&m_mutex);
+        foreach (const Route &route, m_routes) {
+            if (route.pHandler != nullptr) {
+                disconnect(route.pHandler, 0, this, 0);
+                guards.append(route.pGuard);
+            }
+        }
+        m_routes.clear();
+    }
+    releaseGuards(guards);
+}
+
+HttpBulkhead* HttpRequestRouter::addBulkhead(const QString &name, int threadCount, int maxQueued)
 {
     QMutexLocker locker(&m_mutex);
-    m_handlers.clear();
+    HttpBulkhead *pBulkhead = m_bulkheads.value(name);
+    if (pBulkhead == nullptr) {
+        pBulkhead = new HttpBulkhead(name, threadCount, maxQueued);
+        m_bulkheads.insert(name, pBulkhead);
+    }
+    return pBulkhead;
+}
+
+HttpBulkhead* HttpRequestRouter::bulkhead(const QString &name) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bulkheads.value(name);
 }
 
 void HttpRequestRouter::handleRequest(const HttpRequest &request, HttpResponse &response)
 {
-    HttpRequestHandler *pHandler = findRequestHandler(request);
-    if (pHandler == nullptr) {
+    RouteTable routes;
+    {
+        QMutexLocker locker(&m_mutex);
+        routes = m_routes;
+    }
+
+    const Route *pRoute = nullptr;
+    if (request.routeToken() != 0) {
+        pRoute = findRoute(routes, request.routeToken());
+    }
+    if (pRoute == nullptr) {
+        // Not resolved yet, or unmapped since
+        pRoute = findRoute(routes, request);
+    }
+    if (pRoute == nullptr) {
         response.setStatus(HttpResponse::NotFound);
+        response.finalize();
         return;
     }
 
+    if (pRoute->options.timeout() >= 0) {
+        response.setTimeout(pRoute->options.timeout());
+    }
+
+    HttpBulkhead *pBulkhead = nullptr;
+    if (!pRoute->options.bulkhead().isEmpty()) {
+        pBulkhead = bulkhead(pRoute->options.bulkhead());
+    }
+    if (pBulkhead != nullptr) {
+        HttpRequestFunction function = pRoute->function;
+        if (pRoute->pHandler != nullptr) {
+            // The handler may get unmapped while the request waits,
+            // unmapping waits for it to return once started.
+            HandlerGuardPtr pGuard = pRoute->pGuard;
+            function = [pGuard](const HttpRequest &request, HttpResponse &response) {
+                QReadLocker locker(&pGuard->lock);
+                if (pGuard->pHandler == nullptr) {
+                    response.setStatus(HttpResponse::NotFound);
+                } else {
+                    pGuard->pHandler->handleRequest(request, response);
+                }
+            };
+        }
+
+        // Executed in the bulkhead's threads, request and response are moved there.
+        HttpExchange exchange = response.takeExchange();
+        if (!exchange.isNull()) {
+            pBulkhead->run(std::move(exchange), function);
+            return;
+        }
+    }
+
     // Handler is executed in the client's handler thread.
-    pHandler->handleRequest(request, response);
+    if (pRoute->pHandler != nullptr) {
+        pRoute->pHandler->handleRequest(request, response);
+    } else {
+        pRoute->function(request, response);
+    }
+}
+
+bool HttpRequestRouter::handleRequestHeaders(HttpRequest &request, HttpResponse &response)
+{
+    RouteTable routes;
+    {
+        QMutexLocker locker(&m_mutex);
+        routes = m_routes;
+    }
+
+    const Route *pRoute = findRoute(routes, request);
+    if (pRoute == nullptr) {
+        // Will be answered with 404 once received
+        return true;
+    }
+
+    request.setRouteToken(pRoute->token);
+    request.setSheddable(pRoute->options.isSheddable());
+    request.setPriority(pRoute->options.priority());
+
+    if (pRoute->pHandler != nullptr) {
+        return pRoute->pHandler->handleRequestHeaders(request, response);
+    }
+    if (!pRoute->options.headersHandler().isNull()) {
+        return pRoute->options.headersHandler()(request, response);
+    }
+    return true;
 }
 
 void HttpRequestRouter::onHandlerDeleted(QObject *pObject)
 {
-    QMutexLocker locker(&m_mutex);
+    QList<HandlerGuardPtr> guards;
+    {
+        QMutexLocker locker(&m_mutex);
 
-    HttpRequestHandler *pHandler = qobject_cast<HttpRequestHandler*>(pObject);
-    if (pHandler != nullptr) {
-        unmapUnsafe(pHandler);
+        // The object is being destroyed, so only pointer comparison is valid here.
+        HttpRequestHandler *pHandler = static_cast<HttpRequestHandler*>(pObject);
+        if (pHandler != nullptr) {
+            guards = unmapUnsafe(pHandler);
+        }
     }
+
+    // Too late for requests running in bulkheads (see map()),
+    // but those waiting for a thread get 404 Not Found.
+    releaseGuards(guards);
 }
 
-void HttpRequestRouter::unmapUnsafe(HttpRequestHandler *pHandler)
+QList<HttpRequestRouter::HandlerGuardPtr> HttpRequestRouter::unmapUnsafe(HttpRequestHandler *pHandler)
 {
     Q_ASSERT(pHandler != nullptr);
 
-    QMutableListIterator<PatternHandlerPair> it(m_handlers);
+    QList<HandlerGuardPtr> guards;
+    QMutableVectorIterator<Route> it(m_routes);
     while (it.hasNext()) {
-        PatternHandlerPair h = it.next();
-        if (h.second == pHandler) {
-            disconnect(pHandler, 0, this, 0);
+        const Route &route = it.next();
+        if (route.pHandler == pHandler) {
+            guards.append(route.pGuard);
             it.remove();
         }
     }
+    disconnect(pHandler, 0, this, 0);
+    return guards;
 }
 
-HttpRequestHandler* HttpRequestRouter::findRequestHandler(const HttpRequest &request)
+void HttpRequestRouter::releaseGuards(const QList<HandlerGuardPtr> &guards)
 {
-    QString url(request.uri());
+    foreach (const HandlerGuardPtr &pGuard, guards) {
+        QWriteLocker locker(&pGuard->lock);
+        pGuard->pHandler = nullptr;
+    }
+}
 
-    QMutexLocker locker(&m_mutex);
+const HttpRequestRouter::Route* HttpRequestRouter::findRoute(const RouteTable &routes, const HttpRequest &request)
+{
+    QString url(request.uri());
 
-    foreach (const PatternHandlerPair &p, m_handlers) {
-        QRegExp regExp = p.first;
+    for (RouteTable::const_iterator it = routes.constBegin(); it != routes.constEnd(); ++it) {
+        QRegExp regExp = it->pattern;
 
         if (regExp.indexIn(url) != -1) {
-            HttpRequestHandler *pHandler = p.second;
-            Q_ASSERT(pHandler != nullptr);
-            return pHandler;
+            Q_ASSERT(it->pHandler != nullptr || !it->function.isNull());
+            return it;
         }
     }
 
     // No handler found.
     return nullptr;
 }
+
+const HttpRequestRouter::Route* HttpRequestRouter::findRoute(const RouteTable &routes, Token token)
+{
+    for (RouteTable::const_iterator it = routes.constBegin(); it != routes.constEnd(); ++it) {
+        if (it->token == token) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+HttpRequestRouter::Token HttpRequestRouter::nextToken()
+{
+    return sNextToken.fetchAndAddRelaxed(1);
+}
@@ -18,43 +18,147 @@
 #ifndef HTTPREQUESTROUTER_H
 #define HTTPREQUESTROUTER_H
 
+#include <QHash>
 #include <QMutex>
+#include <QReadWriteLock>
+#include <QRegExp>
+#include <QSharedPointer>
+#include <QVector>
 #include "HttpServerApi.h"
 #include "HttpRequestHandler.h"
+#include "HttpRouteOptions.h"
+
+class HttpBulkhead;
 
 class HTTP_API HttpRequestRouter : public HttpRequestHandler
 {
     Q_OBJECT
 public:
+
+    /// Route identifier returned when mapping a function.
+    typedef quint64 Token;
+
     explicit HttpRequestRouter(QObject *pParent = nullptr);
     ~HttpRequestRouter();
 
-    HttpRequestRouter& map(const QRegExp &pattern, HttpRequestHandler *pHandler);
+    /**
+     * Map a handler object to the URL pattern.
+     * The route is removed when the handler is deleted. A handler
+     * running in a bulkhead must be unmapped before it is deleted,
+     * since deletion does not wait for its requests.
+     */
+    HttpRequestRouter& map(const QRegExp &pattern,
+                           HttpRequestHandler *pHandler,
+                           const HttpRouteOptions &options = HttpRouteOptions());
+
+    /**
+     * Remove the routes of a handler object.
+     * Waits for the handler's requests running in bulkheads, those
+     * still waiting for a bulkhead thread get 404 Not Found. Must not
+     * be called from a handler running in a bulkhead.
+     */
     HttpRequestRouter& unmap(HttpRequestHandler *pHandler);
 
+    /**
+     * Map a function to the URL pattern.
+     * The function is stored in the route table and called directly
+     * in the client's handler thread. Unlike handler objects, functions
+     * are not tracked for deletion: the route lives until it is
+     * unmapped by its token or the router is cleared.
+     * @param pattern URL pattern.
+     * @param function Function, lambda or functor to be called.
+     * @param options Route options.
+     * @return Route token.
+     */
+    Token map(const QRegExp &pattern,
+              const HttpRequestFunction &function,
+              const HttpRouteOptions &options = HttpRouteOptions());
+
+    /**
+     * Remove route by its token.
+     * @param token Token returned by map().
+     * @return true if the route has been removed.
+     */
+    bool unmap(Token token);
+
     /**
      * Remove all handlers.
      */
     void clear();
 
+    /**
+     * Create a bulkhead routes can be assigned to by name
+     * (see HttpRouteOptions::setBulkhead()). Bulkheads are owned
+     * by the router and live as long as it does.
+     * @param name Bulkhead name.
+     * @param threadCount Number of threads (and requests in flight).
+     * @param maxQueued Requests allowed to wait for a thread;
+     *        further requests are answered with 503 Service Unavailable.
+     * @return The bulkhead, or the existing one of that name.
+     */
+    HttpBulkhead* addBulkhead(const QString &name, int threadCount, int maxQueued = 0);
+
+    /**
+     * Get a bulkhead by name.
+     * @return nullptr if there is no such bulkhead.
+     */
+    HttpBulkhead* bulkhead(const QString &name) const;
+
     void handleRequest(const HttpRequest &request, HttpResponse &response);
 
+    /**
+     * Resolve the route and pass the headers to its handler.
+     * The resolved route is remembered in the request, so that
+     * handleRequest() does not need to match it again.
+     */
+    bool handleRequestHeaders(HttpRequest &request, HttpResponse &response);
+
 private slots:
 
     void onHandlerDeleted(QObject *pObject);
 
 private:
 
-    void unmapUnsafe(HttpRequestHandler *pHandler);
-    HttpRequestHandler* findRequestHandler(const HttpRequest &request);
+    /// Handler object shared with the requests sent to bulkheads.
+    struct HandlerGuard {
+        QReadWriteLock lock;            ///< Held for reading while the handler runs.
+        HttpRequestHandler *pHandler;   ///< Handler, nullptr once unmapped.
+    };
 
-    QMutex m_mutex; ///< Protective mutex.
+    typedef QSharedPointer<HandlerGuard> HandlerGuardPtr;
 
-    /// URL pattern to handler pair.
-    typedef QPair<QRegExp, HttpRequestHandler*> PatternHandlerPair;
+    /// Entry of the routing table.
+    struct Route {
+        QRegExp pattern;                ///< URL pattern.
+        HttpRequestHandler *pHandler;   ///< Handler object (if any).
+        HandlerGuardPtr pGuard;         ///< Guard of the handler object (if any).
+        HttpRequestFunction function;   ///< Handler function (if no handler object).
+        HttpRouteOptions options;       ///< Route options.
+        Token token;                    ///< Route identifier.
+    };
+
+    typedef QVector<Route> RouteTable;
+
+    QList<HandlerGuardPtr> unmapUnsafe(HttpRequestHandler *pHandler);
+
+    /// Wait for the handlers to return from bulkheads and clear them.
+    static void releaseGuards(const QList<HandlerGuardPtr> &guards);
+    static const Route* findRoute(const RouteTable &routes, const HttpRequest &request);
+    static const Route* findRoute(const RouteTable &routes, Token token);
+    static Token nextToken();
+
+    mutable QMutex m_mutex; ///< Protective mutex.
+
+    /**
+     * List of routes.
+     * The table is implicitly shared: request dispatching takes a snapshot
+     * under the mutex and matches without holding it, so that functions
+     * remain valid even if they get unmapped concurrently.
+     */
+    RouteTable m_routes;
 
-    /// List of request handlers.
-    QList<PatternHandlerPair> m_handlers;
+    /// Bulkheads by name.
+    QHash<QString, HttpBulkhead*> m_bulkheads;
 };
 
 #endif // HTTPREQUESTROUTER_H
@@ -15,7 +15,10 @@
     Lesser General Public License for more details.
 */
 
+#include <QBuffer>
 #include "HttpOption.h"
+#include "HttpDeferredResponse.h"
+#include "HttpExchange.h"
 #include "HttpResponse.h"
 
 static QMap<HttpResponse::Status, QString> sStatusToReasonMap {
@@ -53,6 +56,7 @@ static QMap<HttpResponse::Status, QString> sStatusToReasonMap {
     {HttpResponse::UnsupportedMediaType, "Unsupported Media Type"},
     {HttpResponse::RequestedRangeNotSatisfiable, "Requested Range Not Satisfiable"},
     {HttpResponse::ExpectationFailed, "Expectation Failed"},
+    {HttpResponse::RequestHeaderFieldsTooLarge, "Request Header Fields Too Large"},
     {HttpResponse::InternalServerError, "Internal Server Error"},
     {HttpResponse::NotImplemented, "Not Implemented"},
     {HttpResponse::BadGateway, "Bad Gateway"},
@@ -71,6 +75,9 @@ HttpResponse::HttpResponse(IHttpClientHandler *pClientHandler)
       m_contentType(HttpContentType::TextHtml),
       m_data(),
       m_socketPtr(nullptr),
+      m_output(),
+      m_timeout(-1),
+      m_detached(false),
       m_sent(false)
 {
 }
@@ -85,6 +92,9 @@ HttpResponse::HttpResponse(Status s, IHttpClientHandler *pClientHandler)
       m_contentType(HttpContentType::TextHtml),
       m_data(),
       m_socketPtr(nullptr),
+      m_output(),
+      m_timeout(-1),
+      m_detached(false),
       m_sent(false)
 {
 }
@@ -99,6 +109,9 @@ HttpResponse::HttpResponse(const HttpResponse &r)
       m_contentType(HttpContentType::TextHtml),
       m_data(r.m_data),
       m_socketPtr(r.m_socketPtr),
+      m_output(r.m_output),
+      m_timeout(r.m_timeout),
+      m_detached(r.m_detached),
       m_sent(false)
 {
 }
@@ -114,6 +127,46 @@ HttpResponse& HttpResponse::operator =(const HttpResponse &r)
         m_cookies = r.m_cookies;
         m_data = r.m_data;
         m_socketPtr = r.m_socketPtr;
+        m_output = r.m_output;
+        m_timeout = r.m_timeout;
+        m_detached = r.m_detached;
+        m_sent = r.m_sent;
+    }
+    return *this;
+}
+
+HttpResponse::HttpResponse(HttpResponse &&r) noexcept
+    : m_pClientHandler(r.m_pClientHandler),
+      m_majorVersion(r.m_majorVersion),
+      m_minorVersion(r.m_minorVersion),
+      m_status(r.m_status),
+      m_options(std::move(r.m_options)),
+      m_cookies(std::move(r.m_cookies)),
+      m_contentType(r.m_contentType),
+      m_data(std::move(r.m_data)),
+      m_socketPtr(r.m_socketPtr),
+      m_output(std::move(r.m_output)),
+      m_timeout(r.m_timeout),
+      m_detached(r.m_detached),
+      m_sent(r.m_sent)
+{
+}
+
+HttpResponse& HttpResponse::operator =(HttpResponse &&r) noexcept
+{
+    if (this != &r) {
+        m_pClientHandler = r.m_pClientHandler;
+        m_majorVersion = r.m_majorVersion;
+        m_minorVersion = r.m_minorVersion;
+        m_status = r.m_status;
+        m_options = std::move(r.m_options);
+        m_cookies = std::move(r.m_cookies);
+        m_contentType = r.m_contentType;
+        m_data = std::move(r.m_data);
+        m_socketPtr = r.m_socketPtr;
+        m_output = std::move(r.m_output);
+        m_timeout = r.m_timeout;
+        m_detached = r.m_detached;
         m_sent = r.m_sent;
     }
     return *this;
@@ -124,6 +177,11 @@ QTcpSocket* HttpResponse::socket() const
     return m_socketPtr.data();
 }
 
+bool HttpResponse::isConnected() const
+{
+    return m_detached || (!m_socketPtr.isNull() && m_socketPtr->state() == QAbstractSocket::ConnectedState);
+}
+
 void HttpResponse::setSocket(QTcpSocket *pSocket)
 {
     m_socketPtr = pSocket;
@@ -131,8 +189,8 @@ void HttpResponse::setSocket(QTcpSocket *pSocket)
 
 void HttpResponse::send()
 {
-    Q_ASSERT(!m_socketPtr.isNull());
-    if (m_socketPtr.isNull()) {
+    Q_ASSERT(m_detached || !m_socketPtr.isNull());
+    if (!m_detached && m_socketPtr.isNull()) {
         return;
     }
 
@@ -147,7 +205,14 @@ void HttpResponse::send()
             .arg(static_cast<int>(m_status))
             .arg(statusToString(m_status));
 
-    QDataStream out(m_socketPtr.data());
+    QBuffer buffer(&m_output);
+    QIODevice *pDevice = m_socketPtr.data();
+    if (m_detached) {
+        buffer.open(QIODevice::Append);
+        pDevice = &buffer;
+    }
+
+    QDataStream out(pDevice);
     QByteArray ba = res.toLatin1();
     out.writeRawData(ba.constData(), ba.length());
 
@@ -171,6 +236,11 @@ void HttpResponse::send()
 
 void HttpResponse::sendData(const QByteArray &data)
 {
+    if (m_detached) {
+        m_output.append(data);
+        return;
+    }
+
     Q_ASSERT(!m_socketPtr.isNull());
     if (!m_socketPtr.isNull()) {
         m_socketPtr->write(data);
@@ -184,6 +254,41 @@ void HttpResponse::finalize()
     }
 }
 
+HttpDeferredResponse HttpResponse::defer()
+{
+    if (m_pClientHandler != nullptr) {
+        return m_pClientHandler->deferResponse();
+    }
+    return HttpDeferredResponse();
+}
+
+HttpExchange HttpResponse::takeExchange()
+{
+    if (m_pClientHandler != nullptr) {
+        return m_pClientHandler->takeExchange();
+    }
+    return HttpExchange();
+}
+
+void HttpResponse::detach()
+{
+    m_socketPtr = nullptr;
+    m_detached = true;
+}
+
+void HttpResponse::attach(QTcpSocket *pSocket)
+{
+    m_socketPtr = pSocket;
+    m_detached = false;
+
+    if (!m_output.isEmpty()) {
+        if (!m_socketPtr.isNull()) {
+            m_socketPtr->write(m_output);
+        }
+        m_output.clear();
+    }
+}
+
 QString HttpResponse::statusToString(const Status &s)
 {
     return sStatusToReasonMap.value(s, "");
@@ -27,6 +27,9 @@
 #include "HttpContentType.h"
 #include "IHttpClientHandler.h"
 
+class HttpDeferredResponse;
+class HttpExchange;
+
 class HTTP_API HttpResponse
 {
 public:
@@ -66,6 +69,7 @@ public:
         UnsupportedMediaType    = 415,
         RequestedRangeNotSatisfiable    = 416,
         ExpectationFailed   = 417,
+        RequestHeaderFieldsTooLarge = 431,
         InternalServerError = 500,
         NotImplemented      = 501,
         BadGateway          = 502,
@@ -82,6 +86,8 @@ public:
     HttpResponse(Status s, IHttpClientHandler *pClientHandler = nullptr);
     HttpResponse(const HttpResponse &r);
     HttpResponse& operator =(const HttpResponse &r);
+    HttpResponse(HttpResponse &&r) noexcept;
+    HttpResponse& operator =(HttpResponse &&r) noexcept;
 
     Status status() const { return m_status; }
     void setStatus(Status s) { m_status = s; }
@@ -105,16 +111,34 @@ public:
     QTcpSocket* socket() const;
     void setSocket(QTcpSocket *pSocket);
 
+    /**
+     * Tells whether the client is still connected,
+     * i.e. whether data sent would reach it.
+     * A response held by an exchange is not attached to the socket
+     * and always reports true (see HttpRequest::isCancelled()).
+     */
+    bool isConnected() const;
+
     HttpContentType contentType() const { return m_contentType; }
     void setContentType(const HttpContentType &contentType) { m_contentType = contentType; }
 
+    /**
+     * Time (in milliseconds) given to the handler to finalize this response.
+     * Negative value means server's default, zero means no timeout.
+     */
+    int timeout() const { return m_timeout; }
+    void setTimeout(int ms) { m_timeout = ms; }
+
     /**
      * Send this response.
+     * A response held by an exchange keeps the data until
+     * the exchange is finished, to be written on the connection's thread.
      */
     void send();
 
     /**
      * Send some unstructured data.
+     * Buffered as with send() for a response held by an exchange.
      * @param data
      */
     void sendData(const QByteArray &data);
@@ -127,16 +151,49 @@ public:
 
     /**
      * Finalize the response.
+     * This must be called in the connection's thread,
+     * use defer() to complete the response from another thread.
      */
     void finalize();
 
+    /**
+     * Defer the response.
+     * The handler may return right away and complete the response
+     * later, from any thread, via the returned token.
+     * @return Completion token (null if there is no client handler).
+     */
+    HttpDeferredResponse defer();
+
+    /**
+     * Take the request and this response out of the connection.
+     * The handler may return right away and complete the exchange
+     * later, from any thread. The request and response references
+     * passed to the handler must not be used afterwards.
+     * @return Exchange handle (null if there is no client handler
+     *         or the exchange has already been taken).
+     */
+    HttpExchange takeExchange();
+
     static QString statusToString(const Status &s);
 
 private:
 
+    friend class HttpExchange;
+
     void sendOptions(QDataStream &out);
     void sendCookies(QDataStream &out);
 
+    /**
+     * Detach from the socket: data sent is buffered from now on.
+     */
+    void detach();
+
+    /**
+     * Attach to the socket and write the buffered data.
+     * Must be called in the socket's thread.
+     */
+    void attach(QTcpSocket *pSocket);
+
     IHttpClientHandler* m_pClientHandler;
 
     int m_majorVersion;
@@ -147,7 +204,10 @@ private:
     HttpContentType m_contentType;
     QByteArray m_data;
     QPointer<QTcpSocket> m_socketPtr;
-    bool m_sent;    ///< Flag to tell the response has been sent.
+    QByteArray m_output;    ///< Data sent while detached.
+    int m_timeout;          ///< Finalization timeout, ms.
+    bool m_detached;        ///< Whether sent data is buffered (see detach()).
+    bool m_sent;            ///< Flag to tell the response has been sent.
 };
 
 #endif // HTTPRESPONSE_H
@@ -0,0 +1,86 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPROUTEOPTIONS_H
+#define HTTPROUTEOPTIONS_H
+
+#include <QString>
+#include "HttpServerApi.h"
+#include "HttpRequestHandler.h"
+
+/**
+ * Per-route settings of HttpRequestRouter.
+ * Setters return a reference so options can be chained:
+ *
+ *     router.map(pattern, handler, HttpRouteOptions().setTimeout(5000));
+ */
+class HTTP_API HttpRouteOptions
+{
+public:
+
+    HttpRouteOptions();
+
+    /**
+     * Response finalization timeout (in milliseconds) for this route.
+     * Negative value means server's default (see HttpServerConfig),
+     * zero disables the timeout.
+     */
+    int timeout() const { return m_timeout; }
+    HttpRouteOptions& setTimeout(int ms) { m_timeout = ms; return *this; }
+
+    /**
+     * Whether requests of this route may be shed under overload
+     * (see HttpServerConfig::sheddingTarget()). Health checks and
+     * other routes that must stay responsive should not be sheddable.
+     */
+    bool isSheddable() const { return m_sheddable; }
+    HttpRouteOptions& setSheddable(bool v) { m_sheddable = v; return *this; }
+
+    /**
+     * Priority class of requests of this route (see HttpScheduler).
+     * Default is HttpRequest::Priority_Normal.
+     */
+    HttpRequest::Priority priority() const { return m_priority; }
+    HttpRouteOptions& setPriority(HttpRequest::Priority p) { m_priority = p; return *this; }
+
+    /**
+     * Name of the bulkhead running the route's handler
+     * (see HttpRequestRouter::addBulkhead()). Empty name (default)
+     * runs the handler in the connection's thread.
+     */
+    const QString& bulkhead() const { return m_bulkhead; }
+    HttpRouteOptions& setBulkhead(const QString &name) { m_bulkhead = name; return *this; }
+
+    /**
+     * Function called when the request headers are received
+     * (see HttpRequestHandler::handleRequestHeaders()).
+     * Used by routes mapped to functions, e.g. to stream
+     * the request body into a consumer.
+     */
+    const HttpRequestHeadersFunction& headersHandler() const { return m_headersHandler; }
+    HttpRouteOptions& setHeadersHandler(const HttpRequestHeadersFunction &f) { m_headersHandler = f; return *this; }
+
+private:
+
+    int m_timeout;  ///< Response timeout, ms.
+    bool m_sheddable;   ///< Whether requests may be shed.
+    HttpRequest::Priority m_priority;   ///< Priority class.
+    QString m_bulkhead; ///< Bulkhead name.
+    HttpRequestHeadersFunction m_headersHandler;    ///< Request headers handler.
+};
+
+#endif // HTTPROUTEOPTIONS_H
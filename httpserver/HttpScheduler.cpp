@@ -0,0 +1,209 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <QAtomicInteger>
+#include <QThreadStorage>
+#include "HttpClientHandler.h"
+#include "HttpScheduler.h"
+
+static QThreadStorage<HttpScheduler*> sScheduler;
+
+/// Process-wide statistics of a priority class.
+struct ClassCounters
+{
+    QAtomicInteger<quint64> count;
+    QAtomicInteger<quint64> shed;
+    QAtomicInteger<qint64> totalLatency;
+    QAtomicInteger<qint64> maxLatency;
+};
+
+static ClassCounters sCounters[HttpRequest::PriorityCount];
+
+HttpScheduler* HttpScheduler::instance()
+{
+    if (!sScheduler.hasLocalData()) {
+        sScheduler.setLocalData(new HttpScheduler());
+    }
+    return sScheduler.localData();
+}
+
+HttpScheduler::HttpScheduler()
+    : QObject(),
+      m_clock(),
+      m_posted(false)
+{
+    m_clock.start();
+
+    for (int i = 0; i < HttpRequest::PriorityCount; i++) {
+        m_queues[i].pFirst = nullptr;
+        m_queues[i].pLast = nullptr;
+        m_queues[i].count = 0;
+        m_credits[i] = weight(static_cast<HttpRequest::Priority>(i));
+    }
+}
+
+int HttpScheduler::weight(HttpRequest::Priority priority)
+{
+    // Twice the share of the class below
+    return 1 << static_cast<int>(priority);
+}
+
+void HttpScheduler::schedule(HttpClientHandler *pHandler, HttpRequest::Priority priority)
+{
+    Q_ASSERT(pHandler != nullptr);
+    Q_ASSERT(priority >= 0 && priority < HttpRequest::PriorityCount);
+
+    pHandler->m_scheduledPriority = priority;
+    enqueue(m_queues[priority], pHandler);
+    post();
+}
+
+void HttpScheduler::cancel(HttpClientHandler *pHandler)
+{
+    Q_ASSERT(pHandler != nullptr);
+
+    Queue &queue = m_queues[pHandler->m_scheduledPriority];
+    if (pHandler->m_pPrevScheduled == nullptr && queue.pFirst != pHandler) {
+        // Not queued
+        return;
+    }
+    remove(queue, pHandler);
+}
+
+int HttpScheduler::queuedCount() const
+{
+    int count = 0;
+    for (int i = 0; i < HttpRequest::PriorityCount; i++) {
+        count += m_queues[i].count;
+    }
+    return count;
+}
+
+void HttpScheduler::addLatency(HttpRequest::Priority priority, qint64 latency)
+{
+    ClassCounters &counters = sCounters[priority];
+    counters.count.ref();
+    counters.totalLatency.fetchAndAddRelaxed(latency);
+
+    qint64 max = counters.maxLatency.load();
+    while (latency > max && !counters.maxLatency.testAndSetOrdered(max, latency)) {
+        max = counters.maxLatency.load();
+    }
+}
+
+void HttpScheduler::addShed(HttpRequest::Priority priority)
+{
+    sCounters[priority].shed.ref();
+}
+
+HttpScheduler::Statistics HttpScheduler::statistics(HttpRequest::Priority priority)
+{
+    const ClassCounters &counters = sCounters[priority];
+    Statistics stats;
+    stats.count = counters.count.load();
+    stats.shed = counters.shed.load();
+    stats.totalLatency = counters.totalLatency.load();
+    stats.maxLatency = counters.maxLatency.load();
+    return stats;
+}
+
+void HttpScheduler::resetStatistics()
+{
+    for (int i = 0; i < HttpRequest::PriorityCount; i++) {
+        sCounters[i].count.store(0);
+        sCounters[i].shed.store(0);
+        sCounters[i].totalLatency.store(0);
+        sCounters[i].maxLatency.store(0);
+    }
+}
+
+void HttpScheduler::dispatch()
+{
+    m_posted = false;
+
+    // Leave the rest for the next pass, so that the event loop
+    // keeps reading sockets (and new high priority requests).
+    for (int i = 0; i < DispatchBatch; i++) {
+        HttpClientHandler *pHandler = next();
+        if (pHandler == nullptr) {
+            return;
+        }
+        pHandler->dispatchRequest();
+    }
+
+    if (queuedCount() > 0) {
+        post();
+    }
+}
+
+HttpClientHandler* HttpScheduler::next()
+{
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = HttpRequest::PriorityCount - 1; i >= 0; i--) {
+            if (m_queues[i].pFirst != nullptr && m_credits[i] > 0) {
+                m_credits[i]--;
+                HttpClientHandler *pHandler = m_queues[i].pFirst;
+                remove(m_queues[i], pHandler);
+                return pHandler;
+            }
+        }
+
+        // Classes with requests waiting have used their share, next round
+        for (int i = 0; i < HttpRequest::PriorityCount; i++) {
+            m_credits[i] = weight(static_cast<HttpRequest::Priority>(i));
+        }
+    }
+    return nullptr;
+}
+
+void HttpScheduler::enqueue(Queue &queue, HttpClientHandler *pHandler)
+{
+    pHandler->m_pPrevScheduled = queue.pLast;
+    pHandler->m_pNextScheduled = nullptr;
+    if (queue.pLast != nullptr) {
+        queue.pLast->m_pNextScheduled = pHandler;
+    } else {
+        queue.pFirst = pHandler;
+    }
+    queue.pLast = pHandler;
+    queue.count++;
+}
+
+void HttpScheduler::remove(Queue &queue, HttpClientHandler *pHandler)
+{
+    if (pHandler->m_pPrevScheduled != nullptr) {
+        pHandler->m_pPrevScheduled->m_pNextScheduled = pHandler->m_pNextScheduled;
+    } else {
+        queue.pFirst = pHandler->m_pNextScheduled;
+    }
+    if (pHandler->m_pNextScheduled != nullptr) {
+        pHandler->m_pNextScheduled->m_pPrevScheduled = pHandler->m_pPrevScheduled;
+    } else {
+        queue.pLast = pHandler->m_pPrevScheduled;
+    }
+    pHandler->m_pPrevScheduled = nullptr;
+    pHandler->m_pNextScheduled = nullptr;
+    queue.count--;
+}
+
+void HttpScheduler::post()
+{
+    if (!m_posted) {
+        m_posted = true;
+        QMetaObject::invokeMethod(this, "dispatch", Qt::QueuedConnection);
+    }
+}
@@ -0,0 +1,137 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPSCHEDULER_H
+#define HTTPSCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include "HttpServerApi.h"
+#include "HttpRequest.h"
+
+class HttpClientHandler;
+
+/**
+ * Priority scheduling of received requests.
+ *
+ * Client handlers whose request is complete queue up in the scheduler
+ * of their thread instead of calling the request handler right away.
+ * The scheduler runs them from the event loop in weighted round-robin
+ * order of their priority class: each round, a class may run as many
+ * requests as its weight before lower classes get their turn, so high
+ * priority requests overtake bulk traffic without starving it.
+ *
+ * There is one scheduler per thread. Its methods are not thread-safe,
+ * except for the statistics, which are process-wide.
+ *
+ * Only requests of connections sharing a thread are ordered. With
+ * a thread pool (see HttpServerConfig::setMaxThreads()) each thread
+ * serves a single connection, so every queue holds one request at
+ * most and priority classes only affect load shedding and statistics.
+ */
+class HTTP_API HttpScheduler : public QObject
+{
+    Q_OBJECT
+public:
+
+    enum {
+        DispatchBatch = 32  ///< Requests run per event loop pass.
+    };
+
+    /// Latency statistics of a priority class.
+    struct Statistics
+    {
+        quint64 count;          ///< Responses sent.
+        quint64 shed;           ///< Requests shed.
+        qint64 totalLatency;    ///< Sum of latencies, ms.
+        qint64 maxLatency;      ///< Longest latency, ms.
+
+        qint64 averageLatency() const { return count > 0 ? totalLatency / static_cast<qint64>(count) : 0; }
+    };
+
+    /**
+     * Scheduler of the current thread.
+     */
+    static HttpScheduler* instance();
+
+    /// Milliseconds elapsed on the scheduler's clock.
+    qint64 now() const { return m_clock.elapsed(); }
+
+    /// Weight of a priority class.
+    static int weight(HttpRequest::Priority priority);
+
+    /**
+     * Queue a handler to run its request.
+     * The handler is called back with dispatchRequest().
+     */
+    void schedule(HttpClientHandler *pHandler, HttpRequest::Priority priority);
+
+    /**
+     * Remove a handler from the queue (e.g. on disconnection).
+     * Takes constant time.
+     */
+    void cancel(HttpClientHandler *pHandler);
+
+    /// Number of handlers waiting on this thread.
+    int queuedCount() const;
+
+    /**
+     * Account for a response sent.
+     * @param latency Time from the request headers being complete
+     *        to the response being sent, ms.
+     */
+    static void addLatency(HttpRequest::Priority priority, qint64 latency);
+
+    /// Account for a request shed.
+    static void addShed(HttpRequest::Priority priority);
+
+    /// Statistics of a priority class since start (or reset).
+    static Statistics statistics(HttpRequest::Priority priority);
+
+    static void resetStatistics();
+
+private slots:
+
+    void dispatch();
+
+private:
+
+    HttpScheduler();
+
+    /// Handlers of a priority class, linked through the handlers.
+    struct Queue
+    {
+        HttpClientHandler *pFirst;
+        HttpClientHandler *pLast;
+        int count;
+    };
+
+    /// Pick the next handler to run, nullptr if none.
+    HttpClientHandler* next();
+
+    static void enqueue(Queue &queue, HttpClientHandler *pHandler);
+    static void remove(Queue &queue, HttpClientHandler *pHandler);
+
+    void post();
+
+    QElapsedTimer m_clock;
+    Queue m_queues[HttpRequest::PriorityCount];   ///< Handlers by class.
+    int m_credits[HttpRequest::PriorityCount];  ///< Requests left to each class this round.
+    bool m_posted;          ///< Whether dispatch() is already posted.
+};
+
+#endif // HTTPSCHEDULER_H
@@ -19,25 +19,68 @@
 #   include <QDebug>
 #endif
 #include <QTcpSocket>
+#include "HttpCpuTopology.h"
 #include "HttpThreadPool.h"
 #include "HttpClientHandler.h"
 #include "HttpRequestRouter.h"
+#include "HttpVirtualHostRouter.h"
 #include "HttpServer.h"
 
 HttpServer::HttpServer(const QHostAddress &address, quint16 port, QObject *pParent)
     : QTcpServer(pParent),
       m_hostAddress(address),
       m_port(port),
+      m_config(),
       //m_pThreadPool(new HttpThreadPool(5, 10, this)),
       m_pThreadPool(nullptr),
-      m_handlers(),
-      m_pRequestRouter(new HttpRequestRouter(this))
+      m_workers(),
+      m_connectionCount(0),
+      m_limiter(),
+      m_acceptPaused(false),
+      m_pRequestRouter(new HttpRequestRouter(this)),
+      m_pVirtualHostRouter(new HttpVirtualHostRouter(m_pRequestRouter, this))
 {
 }
 
 HttpServer::~HttpServer()
 {
-    qDeleteAll(m_handlers);
+    QList<HttpClientHandler*> handlers;
+    foreach (Worker *pWorker, m_workers) {
+        pWorker->connections.forEach([&handlers](HttpClientHandler *pHandler) {
+            handlers.append(pHandler);
+        });
+        handlers.append(pWorker->freeHandlers);
+    }
+
+    foreach (HttpClientHandler *pHandler, handlers) {
+        disconnect(pHandler, 0, this, 0);
+        if (pHandler->thread() == thread()) {
+            delete pHandler;
+        } else {
+            // Deleted by their own thread
+            pHandler->deleteLater();
+        }
+    }
+
+    // Handlers refer to the configuration and the limiter,
+    // wait for the threads to be done with them.
+    if (m_pThreadPool != nullptr) {
+        disconnect(m_pThreadPool, 0, this, 0);
+        delete m_pThreadPool;
+        m_pThreadPool = nullptr;
+    }
+
+    qDeleteAll(m_workers);
+}
+
+HttpRequestRouter* HttpServer::requestRouter(const QString &host)
+{
+    HttpRequestRouter *pRouter = qobject_cast<HttpRequestRouter*>(m_pVirtualHostRouter->handler(host));
+    if (pRouter == nullptr) {
+        pRouter = new HttpRequestRouter(this);
+        m_pVirtualHostRouter->map(host, pRouter);
+    }
+    return pRouter;
 }
 
 void HttpServer::start()
@@ -47,6 +90,38 @@ void HttpServer::start()
         return;
     }
 
+    m_limiter.setMaxPerAddress(m_config.maxConnectionsPerAddress());
+    m_limiter.setRetryAfter(m_config.retryAfter());
+
+    HttpCpuTopology topology = HttpCpuTopology::detect();
+    int firstNode = 0;
+    if (!m_config.networkInterface().isEmpty()) {
+        int index = topology.indexOfNode(HttpCpuTopology::interfaceNode(m_config.networkInterface()));
+        if (index >= 0) {
+            // Accept next to the NIC
+            firstNode = index;
+            HttpCpuTopology::pinCurrentThread(topology.cpus(index));
+        }
+    }
+
+    if (m_pThreadPool == nullptr && m_config.maxThreads() > 0) {
+        int minThreads = qBound(1, m_config.minThreads(), m_config.maxThreads());
+        m_pThreadPool = new HttpThreadPool(minThreads, m_config.maxThreads(), this);
+        m_pThreadPool->setAdaptive(m_config.threadWaitTarget());
+        connect(m_pThreadPool, SIGNAL(threadRemoved(QThread*)), this, SLOT(onThreadRemoved(QThread*)));
+
+        switch (m_config.cpuAffinity()) {
+        case HttpServerConfig::CpuAffinity_Cores:
+            m_pThreadPool->setAffinity(topology.coreSets(firstNode));
+            break;
+        case HttpServerConfig::CpuAffinity_Nodes:
+            m_pThreadPool->setAffinity(topology.nodeSets(firstNode));
+            break;
+        default:
+            break;
+        }
+    }
+
 #ifdef _DEBUG
     qDebug() << "Starting server" << m_hostAddress.toString() << ":" << m_port;
 #endif
@@ -62,23 +137,103 @@ void HttpServer::stop()
 #endif
 }
 
+void HttpServer::closeConnections()
+{
+    // Closing removes handlers from the registry, collect them first.
+    QList<HttpClientHandler*> handlers;
+    foreach (Worker *pWorker, m_workers) {
+        pWorker->connections.forEach([&handlers](HttpClientHandler *pHandler) {
+            handlers.append(pHandler);
+        });
+    }
+
+    foreach (HttpClientHandler *pHandler, handlers) {
+        // Queued for handlers living in other threads
+        QMetaObject::invokeMethod(pHandler, "close");
+    }
+}
+
 void HttpServer::incomingConnection(qintptr handle)
 {
-    // Pass client socket to handler
-    HttpClientHandler *pHandler = new HttpClientHandler(handle, m_pRequestRouter);
+    int maxConnections = m_config.maxConnections();
+    if (maxConnections > 0 && connectionCount() >= maxConnections) {
+        rejectConnection(handle);
+        return;
+    }
 
-    // Move handler to dedicated thread if thread-pooling is used.
+    // Use dedicated thread if thread-pooling is used.
+    QThread *pThread = thread();
     if (m_pThreadPool != nullptr) {
-        QThread *pThread = m_pThreadPool->allocate();
+        pThread = m_pThreadPool->allocate();
         if (pThread == nullptr) {
-            delete pHandler;
-        } else {
-            pHandler->moveToThread(pThread);
+            // No thread to handle the connection
+            rejectConnection(handle);
+            return;
         }
     }
 
-    m_handlers.append(pHandler);
-    connect(pHandler, SIGNAL(over(QObject*)), this, SLOT(onHandlerOver(QObject*)), Qt::QueuedConnection);
+    Worker *pWorker = worker(pThread);
+    HttpClientHandler *pHandler = acquireHandler(pWorker, pThread);
+    pHandler->setConnectionId(pWorker->connections.insert(pHandler));
+    m_connectionCount.ref();
+
+    int softLimit = m_config.softConnectionLimit();
+    if (softLimit > 0 && connectionCount() >= softLimit && !m_acceptPaused) {
+        // Let the listen backlog absorb the burst
+        pauseAccepting();
+        m_acceptPaused = true;
+        m_limiter.addDeferred();
+    }
+
+    // Pass client socket to handler
+    if (pHandler->thread() == thread()) {
+        pHandler->open(handle);
+    } else {
+        QMetaObject::invokeMethod(pHandler, "open", Qt::QueuedConnection, Q_ARG(qintptr, handle));
+    }
+}
+
+HttpServer::Worker* HttpServer::worker(QThread *pThread)
+{
+    Worker *pWorker = m_workers.value(pThread, nullptr);
+    if (pWorker == nullptr) {
+        pWorker = new Worker();
+        m_workers.insert(pThread, pWorker);
+    }
+    return pWorker;
+}
+
+HttpClientHandler* HttpServer::acquireHandler(Worker *pWorker, QThread *pThread)
+{
+    if (!pWorker->freeHandlers.isEmpty()) {
+        return pWorker->freeHandlers.takeLast();
+    }
+
+    HttpClientHandler *pHandler = new HttpClientHandler(m_pVirtualHostRouter, &m_config);
+    pHandler->setConnectionLimiter(&m_limiter);
+    if (pThread != thread()) {
+        pHandler->moveToThread(pThread);
+    }
+
+    // Handlers are not deleted when over, so the notification is only
+    // queued when coming from another thread.
+    connect(pHandler, SIGNAL(over(QObject*)), this, SLOT(onHandlerOver(QObject*)));
+    return pHandler;
+}
+
+void HttpServer::rejectConnection(qintptr handle)
+{
+    m_limiter.addRejected();
+
+    QTcpSocket *pSocket = new QTcpSocket(this);
+    if (!pSocket->setSocketDescriptor(handle)) {
+        delete pSocket;
+        return;
+    }
+
+    connect(pSocket, SIGNAL(disconnected()), pSocket, SLOT(deleteLater()));
+    pSocket->write(m_limiter.rejection());
+    pSocket->disconnectFromHost();
 }
 
 void HttpServer::onHandlerOver(QObject *pObject)
@@ -86,13 +241,44 @@ void HttpServer::onHandlerOver(QObject *pObject)
     Q_ASSERT(pObject != nullptr);
 
     HttpClientHandler *pHandler = qobject_cast<HttpClientHandler*>(pObject);
-    if (m_handlers.contains(pHandler)) {
-        // Release handler's thread
+    QThread *pThread = pObject->thread();
+    Worker *pWorker = m_workers.value(pThread, nullptr);
+    if (pWorker != nullptr && pWorker->connections.remove(pHandler->connectionId(), pHandler)) {
+        m_connectionCount.deref();
+
+        if (m_acceptPaused && connectionCount() < m_config.softConnectionLimit()) {
+            resumeAccepting();
+            m_acceptPaused = false;
+        }
+
+        // Keep the handler for another connection
+        if (pWorker->freeHandlers.count() < m_config.handlerPoolSize()) {
+            pWorker->freeHandlers.append(pHandler);
+        } else {
+            disconnect(pHandler, 0, this, 0);
+            pObject->deleteLater();
+        }
+
+        // Release handler's thread (this may remove the thread and its worker)
         if (m_pThreadPool != nullptr) {
-            m_pThreadPool->putBack(pObject->thread());
+            m_pThreadPool->putBack(pThread);
         }
-        m_handlers.removeOne(pHandler);
+    }
+}
+
+void HttpServer::onThreadRemoved(QThread *pThread)
+{
+    Worker *pWorker = m_workers.take(pThread);
+    if (pWorker == nullptr) {
+        return;
+    }
+
+    Q_ASSERT(pWorker->connections.isEmpty());
+
+    // Deleted when the thread finishes
+    foreach (HttpClientHandler *pHandler, pWorker->freeHandlers) {
         disconnect(pHandler, 0, this, 0);
-        pObject->deleteLater();
+        pHandler->deleteLater();
     }
+    delete pWorker;
 }
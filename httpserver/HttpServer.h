@@ -19,13 +19,18 @@
 #define HTTPSERVER_H
 
 #include <QThreadPool>
+#include <QHash>
 #include <QHostAddress>
 #include <QTcpServer>
 #include "HttpServerApi.h"
+#include "HttpServerConfig.h"
+#include "HttpConnectionRegistry.h"
+#include "HttpConnectionLimiter.h"
 
 class HttpThreadPool;
 class HttpClientHandler;
 class HttpRequestRouter;
+class HttpVirtualHostRouter;
 
 /**
  * Server class.
@@ -48,11 +53,59 @@ public:
                QObject *pParent = nullptr);
     ~HttpServer();
 
+    /**
+     * Returns server configuration.
+     * The configuration should be set up before the server is started.
+     */
+    HttpServerConfig& config() { return m_config; }
+    const HttpServerConfig& config() const { return m_config; }
+
     const QHostAddress& hostAddress() const { return m_hostAddress; }
     quint16 port() const { return m_port; }
 
+    /**
+     * Returns default request router.
+     * This router handles requests that match no virtual host.
+     */
     HttpRequestRouter* requestRouter() const { return m_pRequestRouter; }
 
+    /**
+     * Returns request router of a virtual host.
+     * The router is created on first access and owned by the server.
+     * @param host Host name, e.g. "example.com" or "*.example.com".
+     * @return Request router for the host.
+     */
+    HttpRequestRouter* requestRouter(const QString &host);
+
+    HttpVirtualHostRouter* virtualHostRouter() const { return m_pVirtualHostRouter; }
+
+    /**
+     * Returns the pool of connection threads,
+     * nullptr if connections are handled in the server's thread
+     * (see HttpServerConfig::maxThreads()).
+     */
+    HttpThreadPool* threadPool() const { return m_pThreadPool; }
+
+    /**
+     * Number of live connections.
+     * This method is thread-safe.
+     */
+    int connectionCount() const { return m_connectionCount.load(); }
+
+    /**
+     * Number of connections answered with 503 Service Unavailable
+     * because of the connection limits.
+     * This method is thread-safe.
+     */
+    quint64 rejectedConnections() const { return m_limiter.rejected(); }
+
+    /**
+     * Number of times accepting has been paused on reaching
+     * the soft connection limit.
+     * This method is thread-safe.
+     */
+    quint64 deferredAccepts() const { return m_limiter.deferred(); }
+
 public slots:
 
     /**
@@ -65,6 +118,11 @@ public slots:
      */
     void stop();
 
+    /**
+     * Close all live connections.
+     */
+    void closeConnections();
+
 protected:
 
     void incomingConnection(qintptr handle);
@@ -72,20 +130,52 @@ protected:
 private slots:
 
     void onHandlerOver(QObject *pObject);
+    void onThreadRemoved(QThread *pThread);
 
 private:
     Q_DISABLE_COPY(HttpServer)
 
+    /// Connections served by one thread.
+    struct Worker
+    {
+        HttpConnectionRegistry connections;         ///< Live connections.
+        QList<HttpClientHandler*> freeHandlers;     ///< Idle handlers for reuse.
+    };
+
+    /// Get (or create) the worker of a thread.
+    Worker* worker(QThread *pThread);
+
+    /**
+     * Take an idle handler living in the given thread
+     * or create a new one.
+     */
+    HttpClientHandler* acquireHandler(Worker *pWorker, QThread *pThread);
+
+    /**
+     * Answer a connection with 503 Service Unavailable and close it.
+     */
+    void rejectConnection(qintptr handle);
+
     /// Host address used to listen for incoming connections.
     QHostAddress m_hostAddress;
     /// Server's TCP port number.
     quint16 m_port;
+    /// Server configuration.
+    HttpServerConfig m_config;
     /// Pool of threads used to dispatch client handlers.
     HttpThreadPool *m_pThreadPool;
-    /// List of active handlers.
-    QList<HttpClientHandler*> m_handlers;
+    /// Active and idle handlers, per thread.
+    QHash<QThread*, Worker*> m_workers;
+    /// Number of live connections.
+    QAtomicInt m_connectionCount;
+    /// Connection admission state.
+    HttpConnectionLimiter m_limiter;
+    /// Whether accepting is paused (soft connection limit reached).
+    bool m_acceptPaused;
     /// Handler of HTTP requests (by routing them to specific handlers).
     HttpRequestRouter *m_pRequestRouter;
+    /// Dispatcher of HTTP requests to virtual hosts.
+    HttpVirtualHostRouter *m_pVirtualHostRouter;
 };
 
 #endif // HTTPSERVER_H
@@ -0,0 +1,46 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include "HttpServerConfig.h"
+
+HttpServerConfig::HttpServerConfig()
+    : m_responseTimeout(60000),
+      m_headerTimeout(10000),
+      m_bodyTimeout(30000),
+      m_keepAliveTimeout(15000),
+      m_writeTimeout(30000),
+      m_maxHeaderSize(64 * 1024),
+      m_maxBodySize(0),
+      m_bodySpillThreshold(1024 * 1024),
+      m_maxInflatedBodySize(64 * 1024 * 1024),
+      m_maxFormSize(8 * 1024 * 1024),
+      m_maxThreads(0),
+      m_minThreads(1),
+      m_threadWaitTarget(0),
+      m_handlerPoolSize(64),
+      m_cpuAffinity(CpuAffinity_None),
+      m_networkInterface(),
+      m_softConnectionLimit(0),
+      m_maxConnections(0),
+      m_maxConnectionsPerAddress(0),
+      m_retryAfter(1),
+      m_sheddingTarget(0),
+      m_sheddingInterval(100),
+      m_admissionHandler(),
+      m_priorityClassifier()
+{
+}
@@ -0,0 +1,279 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPSERVERCONFIG_H
+#define HTTPSERVERCONFIG_H
+
+#include <QString>
+#include "HttpServerApi.h"
+#include "HttpRequestHandler.h"
+
+/**
+ * Server configuration.
+ * The configuration is shared by all client handlers
+ * and should not be modified once the server is started.
+ */
+class HTTP_API HttpServerConfig
+{
+public:
+
+    /// Placement of connection threads on CPUs.
+    enum CpuAffinity {
+        CpuAffinity_None,   ///< Threads run on any CPU.
+        CpuAffinity_Cores,  ///< Each thread is pinned to one CPU, spread over NUMA nodes.
+        CpuAffinity_Nodes   ///< Each thread is pinned to the CPUs of one NUMA node.
+    };
+
+    HttpServerConfig();
+
+    /**
+     * Time (in milliseconds) a handler may take to finalize the response.
+     * When exceeded, the request is answered with 503 Service Unavailable,
+     * or 504 Gateway Timeout if the response has been deferred.
+     * Zero disables the timeout. Routes may override it.
+     */
+    int responseTimeout() const { return m_responseTimeout; }
+    void setResponseTimeout(int ms) { m_responseTimeout = ms; }
+
+    /**
+     * Time (in milliseconds) a client may take to send the request line
+     * and headers, counted from the connection or from the first byte
+     * of a request on a kept-alive connection. Zero disables the timeout.
+     */
+    int headerTimeout() const { return m_headerTimeout; }
+    void setHeaderTimeout(int ms) { m_headerTimeout = ms; }
+
+    /**
+     * Longest pause (in milliseconds) while receiving a request body.
+     * Zero disables the timeout.
+     */
+    int bodyTimeout() const { return m_bodyTimeout; }
+    void setBodyTimeout(int ms) { m_bodyTimeout = ms; }
+
+    /**
+     * Time (in milliseconds) a kept-alive connection may stay idle
+     * between requests. Zero disables the timeout.
+     */
+    int keepAliveTimeout() const { return m_keepAliveTimeout; }
+    void setKeepAliveTimeout(int ms) { m_keepAliveTimeout = ms; }
+
+    /**
+     * Longest pause (in milliseconds) while sending a response
+     * the client does not read. Also bounds the time a closed
+     * connection may take to flush its output before the handler
+     * is reused. Zero disables the timeout.
+     */
+    int writeTimeout() const { return m_writeTimeout; }
+    void setWriteTimeout(int ms) { m_writeTimeout = ms; }
+
+    /**
+     * Number of live connections above which the server stops accepting
+     * new ones, leaving them in the listen backlog, until connections
+     * are closed. Zero means no limit.
+     */
+    int softConnectionLimit() const { return m_softConnectionLimit; }
+    void setSoftConnectionLimit(int count) { m_softConnectionLimit = count; }
+
+    /**
+     * Maximum number of live connections. Connections accepted
+     * above it are answered with 503 Service Unavailable and closed.
+     * Zero means no limit.
+     */
+    int maxConnections() const { return m_maxConnections; }
+    void setMaxConnections(int count) { m_maxConnections = count; }
+
+    /**
+     * Maximum number of live connections from one client address.
+     * Connections above it are answered with 503 Service Unavailable
+     * and closed. Zero means no limit.
+     */
+    int maxConnectionsPerAddress() const { return m_maxConnectionsPerAddress; }
+    void setMaxConnectionsPerAddress(int count) { m_maxConnectionsPerAddress = count; }
+
+    /**
+     * Delay (in seconds) suggested to rejected clients
+     * in the Retry-After header.
+     */
+    int retryAfter() const { return m_retryAfter; }
+    void setRetryAfter(int seconds) { m_retryAfter = seconds; }
+
+    /**
+     * Target queueing delay (in milliseconds) of requests: time from
+     * the request being complete to its handler being started, i.e.
+     * its wait in the thread's scheduler, including the event loop lag. When delays stay above the target for a
+     * sheddingInterval(), requests are answered with 503 Service
+     * Unavailable until they fall back (see HttpLoadShedder).
+     * Routes may be exempted (see HttpRouteOptions::setSheddable()).
+     * Zero disables load shedding.
+     */
+    int sheddingTarget() const { return m_sheddingTarget; }
+    void setSheddingTarget(int ms) { m_sheddingTarget = ms; }
+
+    /**
+     * Interval (in milliseconds) over which queueing delays must
+     * exceed the target for requests to be shed.
+     */
+    int sheddingInterval() const { return m_sheddingInterval; }
+    void setSheddingInterval(int ms) { m_sheddingInterval = ms; }
+
+    /**
+     * Maximum size (in bytes) of the request line and headers.
+     * A longer request line is answered with 414 Request URI Too Large,
+     * longer headers with 431 Request Header Fields Too Large.
+     * Zero means no limit other than the arguments storage
+     * (half of HttpArena::MaxCapacity).
+     */
+    qint64 maxHeaderSize() const { return m_maxHeaderSize; }
+    void setMaxHeaderSize(qint64 size) { m_maxHeaderSize = size; }
+
+    /**
+     * Maximum size (in bytes) of a request body.
+     * Larger requests are answered with 413 Request Entity Too Large
+     * without reading the body. Zero means no limit.
+     */
+    qint64 maxBodySize() const { return m_maxBodySize; }
+    void setMaxBodySize(qint64 size) { m_maxBodySize = size; }
+
+    /**
+     * Size (in bytes) above which request bodies are stored
+     * in a temporary file rather than in memory (see HttpRequestBody).
+     * Negative value keeps all bodies in memory.
+     */
+    qint64 bodySpillThreshold() const { return m_bodySpillThreshold; }
+    void setBodySpillThreshold(qint64 size) { m_bodySpillThreshold = size; }
+
+    /**
+     * Maximum size (in bytes) of a compressed request body
+     * once decompressed. Bodies sent with Content-Encoding gzip
+     * or deflate are decompressed as they are received; exceeding
+     * the limit is answered with 413 Request Entity Too Large.
+     * Zero means no limit (other than maxBodySize()).
+     */
+    qint64 maxInflatedBodySize() const { return m_maxInflatedBodySize; }
+    void setMaxInflatedBodySize(qint64 size) { m_maxInflatedBodySize = size; }
+
+    /**
+     * Maximum size (in bytes) of an application/x-www-form-urlencoded
+     * body, which is decoded into request arguments in memory.
+     * Larger forms are answered with 413 Request Entity Too Large.
+     * Zero means no limit other than the arguments storage
+     * (half of HttpArena::MaxCapacity).
+     */
+    qint64 maxFormSize() const { return m_maxFormSize; }
+    void setMaxFormSize(qint64 size) { m_maxFormSize = size; }
+
+    /**
+     * Maximum number of threads serving connections, each thread
+     * serving one connection at a time. Zero (default) handles all
+     * connections in the server's thread. Requests are only ordered
+     * by priority among the connections of a thread (see HttpScheduler).
+     */
+    int maxThreads() const { return m_maxThreads; }
+    void setMaxThreads(int count) { m_maxThreads = count; }
+
+    /**
+     * Number of threads kept even when idle (at least one).
+     */
+    int minThreads() const { return m_minThreads; }
+    void setMinThreads(int count) { m_minThreads = count; }
+
+    /**
+     * Target time (in milliseconds) events may wait in the event loops
+     * of connection threads. When set, the number of threads adapts
+     * between minThreads() and maxThreads() to the observed waits and
+     * CPU utilization (see HttpThreadPool::setAdaptive()). Zero keeps
+     * creating threads up to maxThreads() as needed.
+     */
+    int threadWaitTarget() const { return m_threadWaitTarget; }
+    void setThreadWaitTarget(int ms) { m_threadWaitTarget = ms; }
+
+    /**
+     * Placement of connection threads on CPUs (see HttpCpuTopology).
+     * Pinned threads allocate their buffers on their own NUMA node
+     * and keep them warm in their caches. Threads are assigned
+     * to nodes in turn, starting with the node of networkInterface()
+     * if known. Pinning is only supported on Linux.
+     */
+    CpuAffinity cpuAffinity() const { return m_cpuAffinity; }
+    void setCpuAffinity(CpuAffinity affinity) { m_cpuAffinity = affinity; }
+
+    /**
+     * Network interface the server is reached through, e.g. "eth0".
+     * When set, the server's thread (accepting connections) is pinned
+     * to the CPUs of the interface's NUMA node on start, and that node
+     * is filled first with connection threads.
+     */
+    QString networkInterface() const { return m_networkInterface; }
+    void setNetworkInterface(const QString &name) { m_networkInterface = name; }
+
+    /**
+     * Maximum number of idle client handlers kept per thread.
+     * Handlers of closed connections are reset and reused for new
+     * connections (with their socket and buffers) instead of being
+     * destroyed. Zero disables pooling.
+     */
+    int handlerPoolSize() const { return m_handlerPoolSize; }
+    void setHandlerPoolSize(int size) { m_handlerPoolSize = size; }
+
+    /**
+     * Function admitting requests before their body is received
+     * (e.g. authentication or quota checks). It is called before
+     * the request handler's HttpRequestHandler::handleRequestHeaders().
+     * A rejected request is answered right away with the status set
+     * by the function and, if the client expects 100-continue,
+     * the body is never sent.
+     */
+    const HttpRequestHeadersFunction& admissionHandler() const { return m_admissionHandler; }
+    void setAdmissionHandler(const HttpRequestHeadersFunction &f) { m_admissionHandler = f; }
+
+    /**
+     * Function classifying requests, e.g. by client or header.
+     * It is called once the request headers are received and the
+     * route is resolved, and overrides the route's priority.
+     */
+    const HttpPriorityClassifier& priorityClassifier() const { return m_priorityClassifier; }
+    void setPriorityClassifier(const HttpPriorityClassifier &f) { m_priorityClassifier = f; }
+
+private:
+
+    int m_responseTimeout;          ///< Response finalization timeout, ms.
+    int m_headerTimeout;            ///< Request headers timeout, ms.
+    int m_bodyTimeout;              ///< Request body read timeout, ms.
+    int m_keepAliveTimeout;         ///< Idle connection timeout, ms.
+    int m_writeTimeout;             ///< Response write timeout, ms.
+    qint64 m_maxHeaderSize;         ///< Request line and headers size limit.
+    qint64 m_maxBodySize;           ///< Request body size limit.
+    qint64 m_bodySpillThreshold;    ///< Request body spill threshold.
+    qint64 m_maxInflatedBodySize;   ///< Decompressed request body size limit.
+    qint64 m_maxFormSize;           ///< Url-encoded form size limit.
+    int m_maxThreads;               ///< Connection threads limit.
+    int m_minThreads;               ///< Connection threads kept.
+    int m_threadWaitTarget;         ///< Target event wait in threads, ms.
+    int m_handlerPoolSize;          ///< Idle handlers kept per thread.
+    CpuAffinity m_cpuAffinity;      ///< Placement of connection threads.
+    QString m_networkInterface;     ///< Interface to place the server's thread by.
+    int m_softConnectionLimit;      ///< Live connections to pause accepting at.
+    int m_maxConnections;           ///< Live connections limit.
+    int m_maxConnectionsPerAddress; ///< Live connections limit per client.
+    int m_retryAfter;               ///< Retry-After of rejections, s.
+    int m_sheddingTarget;           ///< Target queueing delay, ms.
+    int m_sheddingInterval;         ///< Load shedding interval, ms.
+    HttpRequestHeadersFunction m_admissionHandler;  ///< Request admission.
+    HttpPriorityClassifier m_priorityClassifier;    ///< Request priority.
+};
+
+#endif // HTTPSERVERCONFIG_H
@@ -0,0 +1,380 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPTASK_H
+#define HTTPTASK_H
+
+/*
+ * Coroutine request handlers.
+ *
+ * This header is only usable by code compiled as C++20
+ * (e.g. CONFIG += c++2a), the library itself does not need it.
+ *
+ *     HttpTask handle(const HttpRequest &request, HttpResponse &response)
+ *     {
+ *         co_await httpSleep(100);
+ *         QByteArray data = co_await httpAwait(QtConcurrent::run(query));
+ *         response.setStatus(HttpResponse::Ok);
+ *         response.setData(data);
+ *     }
+ *
+ *     router.map(QRegExp("^/report"), httpCoroutine(&handle));
+ *
+ * A coroutine handler runs in the connection's thread until its first
+ * suspension, then the thread returns to its event loop. It is resumed
+ * in the same thread, and the response is finalized when the coroutine
+ * returns. If the response times out or the client disconnects while
+ * the coroutine is suspended, the coroutine is destroyed instead of
+ * being resumed, so it never touches a stale request or response.
+ * Coroutine frames are allocated from a per-thread pool.
+ */
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#   define HTTP_HAS_COROUTINES
+#endif
+#endif
+
+#ifdef HTTP_HAS_COROUTINES
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QTcpSocket>
+#include <QTimer>
+#include "HttpRequestHandler.h"
+
+/**
+ * Per-thread pool allocator of coroutine frames.
+ * Frames are grouped in power-of-two size classes; released frames
+ * are kept in the releasing thread's free list for reuse.
+ */
+class HttpFrameAllocator
+{
+public:
+
+    static void* allocate(std::size_t size)
+    {
+        int sizeClass = classOf(size);
+        if (sizeClass < 0) {
+            return ::operator new(size);
+        }
+
+        Pool &pool = threadPool();
+        Block *pBlock = pool.freeLists[sizeClass];
+        if (pBlock != nullptr) {
+            pool.freeLists[sizeClass] = pBlock->pNext;
+            pool.freeCounts[sizeClass]--;
+            return pBlock;
+        }
+        return ::operator new(classSize(sizeClass));
+    }
+
+    static void deallocate(void *p, std::size_t size)
+    {
+        int sizeClass = classOf(size);
+        if (sizeClass < 0) {
+            ::operator delete(p);
+            return;
+        }
+
+        Pool &pool = threadPool();
+        if (pool.freeCounts[sizeClass] >= MaxFreeBlocks) {
+            ::operator delete(p);
+            return;
+        }
+
+        Block *pBlock = static_cast<Block*>(p);
+        pBlock->pNext = pool.freeLists[sizeClass];
+        pool.freeLists[sizeClass] = pBlock;
+        pool.freeCounts[sizeClass]++;
+    }
+
+private:
+
+    enum {
+        MinClassSize = 128,     ///< Smallest pooled frame.
+        NumClasses = 6,         ///< 128 to 4096 bytes.
+        MaxFreeBlocks = 64      ///< Free blocks kept per size class.
+    };
+
+    struct Block {
+        Block *pNext;
+    };
+
+    struct Pool {
+        Block *freeLists[NumClasses] = {};
+        int freeCounts[NumClasses] = {};
+
+        ~Pool()
+        {
+            for (Block *pBlock : freeLists) {
+                while (pBlock != nullptr) {
+                    Block *pNext = pBlock->pNext;
+                    ::operator delete(pBlock);
+                    pBlock = pNext;
+                }
+            }
+        }
+    };
+
+    static Pool& threadPool()
+    {
+        static thread_local Pool sPool;
+        return sPool;
+    }
+
+    static std::size_t classSize(int sizeClass)
+    {
+        return std::size_t(MinClassSize) << sizeClass;
+    }
+
+    static int classOf(std::size_t size)
+    {
+        for (int i = 0; i < NumClasses; i++) {
+            if (size <= classSize(i)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+};
+
+/**
+ * Return type of coroutine request handlers.
+ * The coroutine starts eagerly and owns its frame.
+ */
+class HttpTask
+{
+public:
+
+    class promise_type
+    {
+    public:
+
+        promise_type(const HttpRequest &, HttpResponse &response)
+            : m_pResponse(&response),
+              m_deferred(response.defer())
+        {
+        }
+
+        /// Member functions and lambdas get the object as the first argument.
+        template <typename Object>
+        promise_type(Object &, const HttpRequest &, HttpResponse &response)
+            : m_pResponse(&response),
+              m_deferred(response.defer())
+        {
+        }
+
+        HttpTask get_return_object() noexcept { return HttpTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+
+        void return_void()
+        {
+            if (isAlive()) {
+                m_pResponse->finalize();
+            }
+        }
+
+        void unhandled_exception()
+        {
+            if (isAlive()) {
+                if (!m_pResponse->isSent()) {
+                    m_pResponse->setStatus(HttpResponse::InternalServerError);
+                    m_pResponse->setData(QByteArray());
+                }
+                m_pResponse->finalize();
+            }
+        }
+
+        /**
+         * Tells whether the request is still being served,
+         * i.e. the response has neither timed out nor lost its client.
+         */
+        bool isAlive() const { return m_deferred.isPending(); }
+
+        static void* operator new(std::size_t size) { return HttpFrameAllocator::allocate(size); }
+        static void operator delete(void *p, std::size_t size) { HttpFrameAllocator::deallocate(p, size); }
+
+    private:
+
+        HttpResponse *m_pResponse;
+        HttpDeferredResponse m_deferred;
+    };
+
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    /**
+     * Resume a suspended handler, or destroy it if its request is gone.
+     */
+    static void resume(Handle handle)
+    {
+        if (handle.promise().isAlive()) {
+            handle.resume();
+        } else {
+            handle.destroy();
+        }
+    }
+};
+
+/**
+ * Wrap a coroutine handler into a router function.
+ * @param handler Callable returning HttpTask.
+ */
+template <typename Handler>
+HttpRequestFunction httpCoroutine(Handler handler)
+{
+    return [handler](const HttpRequest &request, HttpResponse &response) {
+        handler(request, response);
+    };
+}
+
+/**
+ * Awaitable suspending the handler for a given time.
+ */
+class HttpSleepAwaiter
+{
+public:
+
+    explicit HttpSleepAwaiter(int ms) : m_ms(ms) {}
+
+    bool await_ready() const noexcept { return m_ms <= 0; }
+
+    void await_suspend(HttpTask::Handle handle)
+    {
+        // Timer fires in the calling (connection's) thread.
+        QTimer::singleShot(m_ms, [handle]() { HttpTask::resume(handle); });
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+
+    int m_ms;
+};
+
+inline HttpSleepAwaiter httpSleep(int ms)
+{
+    return HttpSleepAwaiter(ms);
+}
+
+/**
+ * Awaitable waiting for a QFuture (e.g. a backend call
+ * run with QtConcurrent) without blocking the thread.
+ */
+template <typename T>
+class HttpFutureAwaiter
+{
+public:
+
+    explicit HttpFutureAwaiter(const QFuture<T> &future) : m_future(future) {}
+
+    bool await_ready() const { return m_future.isFinished(); }
+
+    void await_suspend(HttpTask::Handle handle)
+    {
+        QFutureWatcher<T> *pWatcher = new QFutureWatcher<T>();
+        QObject::connect(pWatcher, &QFutureWatcherBase::finished, [pWatcher, handle]() {
+            pWatcher->deleteLater();
+            HttpTask::resume(handle);
+        });
+        pWatcher->setFuture(m_future);
+    }
+
+    T await_resume() const { return m_future.result(); }
+
+private:
+
+    QFuture<T> m_future;
+};
+
+template <>
+inline void HttpFutureAwaiter<void>::await_resume() const
+{
+}
+
+template <typename T>
+HttpFutureAwaiter<T> httpAwait(const QFuture<T> &future)
+{
+    return HttpFutureAwaiter<T>(future);
+}
+
+/**
+ * Awaitable waiting for the socket's write buffer to drain
+ * below a threshold, for streaming large responses.
+ */
+class HttpWritableAwaiter
+{
+public:
+
+    HttpWritableAwaiter(QTcpSocket *pSocket, qint64 threshold)
+        : m_pSocket(pSocket),
+          m_threshold(threshold)
+    {
+    }
+
+    bool await_ready() const
+    {
+        return m_pSocket == nullptr || m_pSocket->bytesToWrite() <= m_threshold;
+    }
+
+    void await_suspend(HttpTask::Handle handle)
+    {
+        m_written = QObject::connect(m_pSocket, &QTcpSocket::bytesWritten, [this, handle]() {
+            if (m_pSocket->bytesToWrite() <= m_threshold) {
+                wakeUp(handle);
+            }
+        });
+        // On disconnection the request is gone and the handler gets destroyed.
+        m_disconnected = QObject::connect(m_pSocket, &QTcpSocket::disconnected, [this, handle]() {
+            wakeUp(handle);
+        });
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+
+    void wakeUp(HttpTask::Handle handle)
+    {
+        QObject::disconnect(m_written);
+        QObject::disconnect(m_disconnected);
+        HttpTask::resume(handle);
+    }
+
+    QTcpSocket *m_pSocket;
+    qint64 m_threshold;
+    QMetaObject::Connection m_written;
+    QMetaObject::Connection m_disconnected;
+};
+
+/**
+ * Wait until the response can be written to without growing
+ * the socket's buffer past the threshold.
+ */
+inline HttpWritableAwaiter httpWritable(HttpResponse &response, qint64 threshold = 0)
+{
+    return HttpWritableAwaiter(response.socket(), threshold);
+}
+
+#endif // HTTP_HAS_COROUTINES
+
+#endif // HTTPTASK_H
@@ -18,19 +18,133 @@
 #if _DEBUG
 #   include <QDebug>
 #endif
+#include <QTimer>
 #include "HttpThreadPool.h"
 
+#if defined(Q_OS_WIN)
+#   include <windows.h>
+#elif defined(Q_OS_UNIX)
+#   include <sys/resource.h>
+#endif
+
+/// Process CPU time (user and system), ms, -1 if unknown.
+static qint64 cpuTime()
+{
+#if defined(Q_OS_WIN)
+    // std::clock() is wall-clock time on Windows
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return -1;
+    }
+    quint64 kernelTime = (quint64(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+    quint64 userTime = (quint64(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+    // 100 ns units
+    return static_cast<qint64>((kernelTime + userTime) / 10000);
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+    return (qint64(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000
+            + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+#else
+    return -1;
+#endif
+}
+
+HttpThreadProbe::HttpThreadProbe(const QElapsedTimer *pClock)
+    : QObject(),
+      m_pClock(pClock),
+      m_mutex(),
+      m_cpus(),
+      m_sentTime(-1),
+      m_lastWait(0)
+{
+    Q_ASSERT(pClock != nullptr);
+}
+
+void HttpThreadProbe::send()
+{
+    if (m_sentTime.load() >= 0) {
+        // Previous ping is still waiting
+        return;
+    }
+
+    qint64 now = m_pClock->elapsed();
+    m_sentTime.store(now);
+    QMetaObject::invokeMethod(this, "ping", Qt::QueuedConnection, Q_ARG(qint64, now));
+}
+
+qint64 HttpThreadProbe::wait() const
+{
+    qint64 wait = m_lastWait.load();
+    qint64 sentTime = m_sentTime.load();
+    if (sentTime >= 0) {
+        wait = qMax(wait, m_pClock->elapsed() - sentTime);
+    }
+    return wait;
+}
+
+HttpCpuTopology::CpuSet HttpThreadProbe::cpus() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_cpus;
+}
+
+void HttpThreadProbe::setCpus(const HttpCpuTopology::CpuSet &cpus)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cpus = cpus;
+}
+
+void HttpThreadProbe::applyAffinity()
+{
+    HttpCpuTopology::CpuSet set = cpus();
+    if (!set.isEmpty() && !HttpCpuTopology::pinCurrentThread(set)) {
+#ifdef _DEBUG
+        qDebug() << "Unable to pin thread to CPUs" << set;
+#endif
+    }
+}
+
+void HttpThreadProbe::ping(qint64 sentTime)
+{
+    m_lastWait.store(m_pClock->elapsed() - sentTime);
+    m_sentTime.store(-1);
+}
+
 HttpThreadPool::HttpThreadPool(int minThreads, int maxThreads, QObject *pParent)
     : QObject(pParent),
       m_threads(),
       m_minThreads(minThreads),
       m_maxThreads(maxThreads),
+      m_threadLimit(maxThreads),
       m_freeThreads(),
-      m_busyThreads()
+      m_busyThreads(),
+      m_probes(),
+      m_cpuSets(),
+      m_createdCount(0),
+      m_clock(),
+      m_pAdjustTimer(nullptr),
+      m_waitTarget(0),
+      m_lastAdjustTime(0),
+      m_lastCpuTime(0),
+      m_refused(0),
+      m_calmPeriods(0),
+      m_lastWait(0),
+      m_lastCpuUtilization(0.0),
+      m_refusedTotal(0),
+      m_growCount(0),
+      m_shrinkCount(0)
 {
     Q_ASSERT(m_minThreads > 0);
     Q_ASSERT(m_maxThreads >= m_minThreads);
 
+    m_clock.start();
+
+    m_pAdjustTimer = new QTimer(this);
+    connect(m_pAdjustTimer, SIGNAL(timeout()), this, SLOT(adjust()));
+
     initThreads();
 }
 
@@ -45,6 +159,7 @@ HttpThreadPool::~HttpThreadPool()
         pThread->wait();
     }
 
+    qDeleteAll(m_probes);
     qDeleteAll(m_threads);
 }
 
@@ -54,12 +169,13 @@ QThread* HttpThreadPool::allocate()
 
     if (m_freeThreads.count() == 0) {
         // No more free threads
-        if (m_threads.count() < m_maxThreads) {
+        if (m_threads.count() < m_threadLimit) {
             // Can still allocate threads
-            pThread = new QThread(this);
-            m_threads.append(pThread);
+            pThread = createThread();
         } else {
             // No more thread can be allocated
+            m_refused++;
+            m_refusedTotal++;
             return nullptr;
         }
     } else {
@@ -68,7 +184,7 @@ QThread* HttpThreadPool::allocate()
 
     Q_ASSERT(pThread != nullptr);
 
-    m_busyThreads.enqueue(pThread);
+    m_busyThreads.insert(pThread);
 
     if (!pThread->isRunning()) {
         pThread->start();
@@ -84,10 +200,14 @@ QThread* HttpThreadPool::allocate()
 void HttpThreadPool::putBack(QThread *pThread)
 {
     Q_ASSERT(pThread != nullptr);
-    Q_ASSERT(m_threads.contains(pThread));
 
-    if (m_busyThreads.removeOne(pThread)) {
-        m_freeThreads.enqueue(pThread);
+    if (m_busyThreads.remove(pThread)) {
+        if (m_threads.count() > m_threadLimit) {
+            // The pool has been shrunk
+            removeThread(pThread);
+        } else {
+            m_freeThreads.enqueue(pThread);
+        }
     }
 
 #ifdef _DEBUG
@@ -95,13 +215,134 @@ void HttpThreadPool::putBack(QThread *pThread)
 #endif
 }
 
+void HttpThreadPool::setAdaptive(int waitTarget, int interval)
+{
+    m_waitTarget = waitTarget;
+    if (waitTarget > 0) {
+        // Start small and grow on demand
+        m_threadLimit = qMax(m_minThreads, m_threads.count());
+        m_lastAdjustTime = m_clock.elapsed();
+        m_lastCpuTime = cpuTime();
+        m_pAdjustTimer->start(interval);
+    } else {
+        m_threadLimit = m_maxThreads;
+        m_pAdjustTimer->stop();
+    }
+}
+
+void HttpThreadPool::setAffinity(const QList<HttpCpuTopology::CpuSet> &cpuSets)
+{
+    m_cpuSets = cpuSets;
+
+    // Threads created so far get the sets in the same order
+    for (int i = 0; i < m_threads.count(); i++) {
+        HttpThreadProbe *pProbe = m_probes.value(m_threads.at(i));
+        pProbe->setCpus(cpuSets.isEmpty() ? HttpCpuTopology::CpuSet() : cpuSets.at(i % cpuSets.count()));
+        if (m_threads.at(i)->isRunning()) {
+            QMetaObject::invokeMethod(pProbe, "applyAffinity", Qt::QueuedConnection);
+        }
+    }
+    m_createdCount = m_threads.count();
+}
+
+void HttpThreadPool::adjust()
+{
+    qint64 now = m_clock.elapsed();
+    qint64 cpu = cpuTime();
+    qint64 wall = (now - m_lastAdjustTime) * QThread::idealThreadCount();
+    if (cpu >= 0 && m_lastCpuTime >= 0 && wall > 0) {
+        m_lastCpuUtilization = static_cast<double>(cpu - m_lastCpuTime) / wall;
+    } else {
+        // CPU time unavailable, size on waits only
+        m_lastCpuUtilization = 0.0;
+    }
+    m_lastAdjustTime = now;
+    m_lastCpuTime = cpu;
+
+    // Collect waits of the pings sent last time and send new ones
+    m_lastWait = 0;
+    foreach (QThread *pThread, m_busyThreads) {
+        HttpThreadProbe *pProbe = m_probes.value(pThread);
+        m_lastWait = qMax(m_lastWait, pProbe->wait());
+        pProbe->send();
+    }
+
+    bool pressure = m_lastWait > m_waitTarget || m_refused > 0;
+    int refused = m_refused;
+    m_refused = 0;
+
+    if (pressure) {
+        m_calmPeriods = 0;
+        if (m_lastCpuUtilization * 100 < CpuCeiling && m_threadLimit < m_maxThreads) {
+            // More threads help only if the CPU has room
+            m_threadLimit = qMin(m_maxThreads, m_threadLimit + qMax(1, refused));
+            m_growCount++;
+            emit resized(m_threadLimit);
+        }
+    } else if (m_lastWait < m_waitTarget / 2 && !m_freeThreads.isEmpty()) {
+        if (++m_calmPeriods >= ShrinkPeriods && m_threadLimit > m_minThreads) {
+            m_calmPeriods = 0;
+            m_threadLimit--;
+            m_shrinkCount++;
+            emit resized(m_threadLimit);
+        }
+    } else {
+        m_calmPeriods = 0;
+    }
+
+    // Busy threads over the limit are removed when put back
+    while (m_threads.count() > m_threadLimit && !m_freeThreads.isEmpty()) {
+        removeThread(m_freeThreads.takeLast());
+    }
+}
+
 void HttpThreadPool::initThreads()
 {
     for (int i = 0; i < m_minThreads; i++) {
-        QThread *pThread = new QThread(this);
-        m_threads.append(pThread);
-        m_freeThreads.enqueue(pThread);
+        m_freeThreads.enqueue(createThread());
+    }
+
+#ifdef _DEBUG
+    dumpStatistics();
+#endif
+}
+
+QThread* HttpThreadPool::createThread()
+{
+    QThread *pThread = new QThread(this);
+    m_threads.append(pThread);
+
+    HttpThreadProbe *pProbe = new HttpThreadProbe(&m_clock);
+    if (!m_cpuSets.isEmpty()) {
+        pProbe->setCpus(m_cpuSets.at(m_createdCount % m_cpuSets.count()));
+    }
+    m_createdCount++;
+    pProbe->moveToThread(pThread);
+    m_probes.insert(pThread, pProbe);
+
+    // Pin the thread before it allocates anything
+    connect(pThread, SIGNAL(started()), pProbe, SLOT(applyAffinity()), Qt::DirectConnection);
+
+    return pThread;
+}
+
+void HttpThreadPool::removeThread(QThread *pThread)
+{
+    emit threadRemoved(pThread);
+
+    m_threads.removeOne(pThread);
+    m_freeThreads.removeOne(pThread);
+
+    HttpThreadProbe *pProbe = m_probes.take(pThread);
+    if (pThread->isRunning()) {
+        // Deleted when the thread finishes
+        pProbe->deleteLater();
+        pThread->quit();
+        pThread->wait();
+    } else {
+        delete pProbe;
     }
+    delete pThread;
 
 #ifdef _DEBUG
     dumpStatistics();
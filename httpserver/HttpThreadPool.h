@@ -18,13 +18,79 @@
 #ifndef HTTPTHREADPOOL_H
 #define HTTPTHREADPOOL_H
 
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QList>
+#include <QMutex>
 #include <QQueue>
+#include <QSet>
 #include <QThread>
 #include "HttpServerApi.h"
+#include "HttpCpuTopology.h"
+
+class QTimer;
+
+/**
+ * Event loop probe living in a pool thread.
+ * Measures how long a posted event waits before being handled.
+ */
+class HTTP_API HttpThreadProbe : public QObject
+{
+    Q_OBJECT
+public:
+
+    explicit HttpThreadProbe(const QElapsedTimer *pClock);
+
+    /**
+     * Post a ping to the probe's thread.
+     * Does nothing if the previous ping is still waiting.
+     */
+    void send();
+
+    /**
+     * Wait (in milliseconds) of the last ping, or the age
+     * of the ping still waiting if longer.
+     */
+    qint64 wait() const;
+
+    /**
+     * CPUs the probe's thread is to run on.
+     * Applied when the thread is started (or with applyAffinity()).
+     */
+    HttpCpuTopology::CpuSet cpus() const;
+    void setCpus(const HttpCpuTopology::CpuSet &cpus);
+
+public slots:
+
+    /**
+     * Pin the calling thread to the probe's CPUs.
+     * Connected directly to the thread's started() signal.
+     */
+    void applyAffinity();
+
+private slots:
+
+    void ping(qint64 sentTime);
+
+private:
+
+    const QElapsedTimer *m_pClock;      ///< Pool clock.
+    mutable QMutex m_mutex;             ///< Guards the CPU set.
+    HttpCpuTopology::CpuSet m_cpus;     ///< CPUs of the thread, empty for any.
+    QAtomicInteger<qint64> m_sentTime;  ///< Time the waiting ping was sent, -1 if none.
+    QAtomicInteger<qint64> m_lastWait;  ///< Wait of the last ping, ms.
+};
 
 /**
  * This class handles a collection of threads.
+ *
+ * The pool can size itself between its bounds: a controller
+ * periodically compares the time events wait in the threads' event
+ * loops with a target, and the process CPU utilization with a ceiling.
+ * Threads are added when events wait too long or connections are
+ * turned away while the CPU has room, and idle threads are removed
+ * after a few calm periods in a row.
  */
 class HTTP_API HttpThreadPool : public QObject
 {
@@ -49,8 +115,70 @@ public:
      */
     void putBack(QThread *pThread);
 
+    /**
+     * Enable adaptive sizing.
+     * @param waitTarget Target event wait in pool threads, ms.
+     * @param interval Period of the controller, ms.
+     */
+    void setAdaptive(int waitTarget, int interval = 1000);
+    bool isAdaptive() const { return m_waitTarget > 0; }
+
+    /**
+     * Pin pool threads to CPUs.
+     * Threads are given the sets in turn, in the order they are created.
+     * Memory the threads allocate first (handler buffers, request
+     * arenas, timers) is then placed on their NUMA node by the kernel.
+     * @param cpuSets CPU sets, empty list to let threads run anywhere.
+     */
+    void setAffinity(const QList<HttpCpuTopology::CpuSet> &cpuSets);
+    const QList<HttpCpuTopology::CpuSet>& affinity() const { return m_cpuSets; }
+
+    int minThreads() const { return m_minThreads; }
+    int maxThreads() const { return m_maxThreads; }
+
+    /// Current limit of threads (between min and max).
+    int threadLimit() const { return m_threadLimit; }
+
+    int threadCount() const { return m_threads.count(); }
+    int busyCount() const { return m_busyThreads.count(); }
+
+    /// Longest event wait over the pool threads at the last adjustment, ms.
+    qint64 lastWait() const { return m_lastWait; }
+
+    /// Process CPU utilization (0..1) at the last adjustment, zero if unknown.
+    double lastCpuUtilization() const { return m_lastCpuUtilization; }
+
+    /// Number of allocations refused since the pool was created.
+    quint64 refusedCount() const { return m_refusedTotal; }
+
+    /// Number of times the limit has been raised and lowered.
+    quint64 growCount() const { return m_growCount; }
+    quint64 shrinkCount() const { return m_shrinkCount; }
+
+signals:
+
+    /**
+     * Emitted when the thread limit is changed by the controller.
+     */
+    void resized(int threadLimit);
+
+    /**
+     * Emitted before an idle thread is stopped and deleted,
+     * so that objects living in the thread can be disposed of.
+     */
+    void threadRemoved(QThread *pThread);
+
+private slots:
+
+    void adjust();
+
 private:
 
+    enum {
+        CpuCeiling = 90,    ///< CPU utilization (%) above which no threads are added.
+        ShrinkPeriods = 5   ///< Calm periods in a row before removing a thread.
+    };
+
     void dumpStatistics();
 
     /**
@@ -58,14 +186,34 @@ private:
      */
     void initThreads();
 
+    QThread* createThread();
+    void removeThread(QThread *pThread);
+
     /// All threads managed by this pool.
     QList<QThread*> m_threads;
 
     int m_minThreads;   ///< Minimal number of reserved threads.
     int m_maxThreads;   ///< Maximal number of threads.
+    int m_threadLimit;  ///< Current number of threads allowed.
 
     QQueue<QThread*> m_freeThreads;
-    QQueue<QThread*> m_busyThreads;
+    QSet<QThread*> m_busyThreads;   ///< Set for O(1) removal.
+    QHash<QThread*, HttpThreadProbe*> m_probes; ///< Event loop probes.
+    QList<HttpCpuTopology::CpuSet> m_cpuSets;   ///< CPU sets to pin threads to.
+    int m_createdCount;         ///< Threads created, to assign CPU sets in turn.
+
+    QElapsedTimer m_clock;
+    QTimer *m_pAdjustTimer;
+    int m_waitTarget;           ///< Target event wait, ms (0 if not adaptive).
+    qint64 m_lastAdjustTime;    ///< Wall time of the last adjustment, ms.
+    qint64 m_lastCpuTime;       ///< Process CPU time at the last adjustment, ms.
+    int m_refused;              ///< Allocations refused since the last adjustment.
+    int m_calmPeriods;          ///< Calm periods in a row.
+    qint64 m_lastWait;
+    double m_lastCpuUtilization;
+    quint64 m_refusedTotal;
+    quint64 m_growCount;
+    quint64 m_shrinkCount;
 };
 
 #endif // HTTPTHREADPOOL_H
@@ -0,0 +1,178 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <QThreadStorage>
+#include <QTimer>
+#include "HttpTimingWheel.h"
+
+static QThreadStorage<HttpTimingWheel*> sTimingWheel;
+
+HttpTimeout::HttpTimeout()
+    : m_pWheel(nullptr),
+      m_pPrev(nullptr),
+      m_pNext(nullptr),
+      m_slot(-1),
+      m_rounds(0),
+      m_callback()
+{
+}
+
+HttpTimeout::~HttpTimeout()
+{
+    cancel();
+}
+
+void HttpTimeout::start(int ms)
+{
+    if (ms <= 0) {
+        cancel();
+        return;
+    }
+
+    HttpTimingWheel *pWheel = HttpTimingWheel::instance();
+    if (m_pWheel != pWheel) {
+        // Armed on another thread's wheel
+        cancel();
+    }
+    pWheel->arm(this, ms);
+}
+
+void HttpTimeout::cancel()
+{
+    if (m_pWheel != nullptr) {
+        m_pWheel->unlink(this);
+    }
+}
+
+HttpTimingWheel* HttpTimingWheel::instance()
+{
+    if (!sTimingWheel.hasLocalData()) {
+        sTimingWheel.setLocalData(new HttpTimingWheel());
+    }
+    return sTimingWheel.localData();
+}
+
+HttpTimingWheel::HttpTimingWheel()
+    : QObject(),
+      m_slots(Slots + 1, nullptr),
+      m_tick(0),
+      m_count(0),
+      m_clock(),
+      m_pTimer(nullptr)
+{
+    m_clock.start();
+
+    m_pTimer = new QTimer(this);
+    m_pTimer->setInterval(Resolution);
+    connect(m_pTimer, SIGNAL(timeout()), this, SLOT(onTick()));
+}
+
+HttpTimingWheel::~HttpTimingWheel()
+{
+    // Detach timeouts still armed
+    for (int i = 0; i < m_slots.count(); i++) {
+        while (m_slots.at(i) != nullptr) {
+            unlink(m_slots.at(i));
+        }
+    }
+}
+
+void HttpTimingWheel::arm(HttpTimeout *pTimeout, int ms)
+{
+    if (pTimeout->m_pWheel == this) {
+        unlink(pTimeout);
+    }
+
+    if (m_count == 0) {
+        // The wheel has been idle, catch up with the clock.
+        m_tick = now();
+        m_pTimer->start();
+    }
+
+    qint64 ticks = (static_cast<qint64>(ms) + Resolution - 1) / Resolution;
+    qint64 deadline = m_tick + ticks;
+    pTimeout->m_rounds = static_cast<int>((ticks - 1) / Slots);
+    link(pTimeout, static_cast<int>(deadline % Slots));
+}
+
+void HttpTimingWheel::link(HttpTimeout *pTimeout, int slot)
+{
+    pTimeout->m_pWheel = this;
+    pTimeout->m_slot = slot;
+    pTimeout->m_pPrev = nullptr;
+    pTimeout->m_pNext = m_slots.at(slot);
+    if (pTimeout->m_pNext != nullptr) {
+        pTimeout->m_pNext->m_pPrev = pTimeout;
+    }
+    m_slots[slot] = pTimeout;
+    m_count++;
+}
+
+void HttpTimingWheel::unlink(HttpTimeout *pTimeout)
+{
+    Q_ASSERT(pTimeout->m_pWheel == this);
+
+    if (pTimeout->m_pPrev != nullptr) {
+        pTimeout->m_pPrev->m_pNext = pTimeout->m_pNext;
+    } else {
+        m_slots[pTimeout->m_slot] = pTimeout->m_pNext;
+    }
+    if (pTimeout->m_pNext != nullptr) {
+        pTimeout->m_pNext->m_pPrev = pTimeout->m_pPrev;
+    }
+
+    pTimeout->m_pWheel = nullptr;
+    pTimeout->m_pPrev = nullptr;
+    pTimeout->m_pNext = nullptr;
+    pTimeout->m_slot = -1;
+    m_count--;
+}
+
+void HttpTimingWheel::onTick()
+{
+    // Several ticks may be due if the thread has been busy.
+    const qint64 target = now();
+    while (m_tick < target) {
+        m_tick++;
+        HttpTimeout *pTimeout = m_slots.at(static_cast<int>(m_tick % Slots));
+        while (pTimeout != nullptr) {
+            HttpTimeout *pNext = pTimeout->m_pNext;
+            if (pTimeout->m_rounds > 0) {
+                pTimeout->m_rounds--;
+            } else {
+                // Move to the expired list
+                unlink(pTimeout);
+                link(pTimeout, Slots);
+            }
+            pTimeout = pNext;
+        }
+    }
+
+    // Reap expired timeouts. Callbacks may arm or cancel
+    // timeouts, including the expired ones not handled yet.
+    while (m_slots.at(Slots) != nullptr) {
+        HttpTimeout *pTimeout = m_slots.at(Slots);
+        unlink(pTimeout);
+        if (!pTimeout->m_callback.isNull()) {
+            pTimeout->m_callback();
+        }
+    }
+
+    if (m_count == 0) {
+        m_pTimer->stop();
+    }
+}
@@ -0,0 +1,133 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPTIMINGWHEEL_H
+#define HTTPTIMINGWHEEL_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QVector>
+#include "HttpServerApi.h"
+#include "HttpFunction.h"
+
+class QTimer;
+class HttpTimingWheel;
+
+/**
+ * Timeout that can be armed on a timing wheel.
+ * Entries are linked into the wheel's slots directly, so arming,
+ * re-arming and cancelling never allocate. An entry is cancelled
+ * when destroyed.
+ */
+class HTTP_API HttpTimeout
+{
+public:
+
+    /// Function called when the timeout expires.
+    typedef HttpFunction<void()> Callback;
+
+    HttpTimeout();
+    ~HttpTimeout();
+
+    const Callback& callback() const { return m_callback; }
+    void setCallback(const Callback &callback) { m_callback = callback; }
+
+    bool isArmed() const { return m_pWheel != nullptr; }
+
+    /**
+     * Arm the timeout on the wheel of the current thread.
+     * Re-arming an armed timeout replaces its deadline.
+     * @param ms Timeout in milliseconds, zero or negative cancels it.
+     */
+    void start(int ms);
+
+    /**
+     * Cancel the timeout (if armed).
+     */
+    void cancel();
+
+private:
+
+    friend class HttpTimingWheel;
+
+    HttpTimeout(const HttpTimeout&) = delete;
+    HttpTimeout& operator =(const HttpTimeout&) = delete;
+
+    HttpTimingWheel *m_pWheel;  ///< Wheel the timeout is armed on.
+    HttpTimeout *m_pPrev;       ///< Previous entry in the slot.
+    HttpTimeout *m_pNext;       ///< Next entry in the slot.
+    int m_slot;                 ///< Slot index.
+    int m_rounds;               ///< Wheel turns left before expiring.
+    Callback m_callback;
+};
+
+/**
+ * Hashed timing wheel.
+ *
+ * Timeouts are hashed by deadline into a ring of slots, one slot per
+ * tick; deadlines beyond one turn of the wheel count the remaining
+ * turns. Arming and cancelling are O(1), and a tick only looks at one
+ * slot. Expired timeouts are collected first and their callbacks
+ * called in a batch, so a callback may re-arm or cancel any timeout.
+ *
+ * There is one wheel per thread; it ticks only while timeouts are armed.
+ */
+class HTTP_API HttpTimingWheel : public QObject
+{
+    Q_OBJECT
+public:
+
+    enum {
+        Resolution = 100,   ///< Tick length, ms.
+        Slots = 512         ///< Slots in the wheel.
+    };
+
+    /**
+     * Wheel of the current thread.
+     */
+    static HttpTimingWheel* instance();
+
+    ~HttpTimingWheel();
+
+    /// Number of armed timeouts.
+    int count() const { return m_count; }
+
+private slots:
+
+    void onTick();
+
+private:
+
+    friend class HttpTimeout;
+
+    HttpTimingWheel();
+
+    void arm(HttpTimeout *pTimeout, int ms);
+    void unlink(HttpTimeout *pTimeout);
+    void link(HttpTimeout *pTimeout, int slot);
+
+    /// Ticks elapsed since the wheel has been created.
+    qint64 now() const { return m_clock.elapsed() / Resolution; }
+
+    QVector<HttpTimeout*> m_slots;  ///< Slot heads, the last one holds expired timeouts.
+    qint64 m_tick;                  ///< Last tick processed.
+    int m_count;                    ///< Armed timeouts.
+    QElapsedTimer m_clock;
+    QTimer *m_pTimer;
+};
+
+#endif // HTTPTIMINGWHEEL_H
@@ -0,0 +1,237 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include "HttpOption.h"
+#include "HttpVirtualHostRouter.h"
+
+HttpVirtualHostRouter::HttpVirtualHostRouter(HttpRequestHandler *pDefaultHandler, QObject *pParent)
+    : HttpRequestHandler(pParent),
+      m_mutex(),
+      m_hosts(),
+      m_wildcardCount(0),
+      m_pDefaultHandler(nullptr)
+{
+    setDefaultHandler(pDefaultHandler);
+}
+
+HttpVirtualHostRouter::~HttpVirtualHostRouter()
+{
+}
+
+HttpVirtualHostRouter& HttpVirtualHostRouter::map(const QString &host, HttpRequestHandler *pHandler)
+{
+    Q_ASSERT(pHandler != nullptr);
+
+    QString key = normalizeHost(host);
+    Q_ASSERT(!key.isEmpty());
+
+    QMutexLocker locker(&m_mutex);
+    if (pHandler != nullptr && !key.isEmpty()) {
+        HttpRequestHandler *pPrevious = m_hosts.value(key, nullptr);
+        if (pPrevious == nullptr && key.startsWith('.')) {
+            m_wildcardCount++;
+        }
+        m_hosts.insert(key, pHandler);
+        disconnect(pHandler, 0, this, 0);
+        connect(pHandler, SIGNAL(destroyed(QObject*)), this, SLOT(onHandlerDeleted(QObject*)));
+    }
+    return *this;
+}
+
+HttpVirtualHostRouter& HttpVirtualHostRouter::unmap(const QString &host)
+{
+    QString key = normalizeHost(host);
+
+    QMutexLocker locker(&m_mutex);
+    HttpRequestHandler *pHandler = m_hosts.take(key);
+    if (pHandler != nullptr) {
+        if (key.startsWith('.')) {
+            m_wildcardCount--;
+        }
+        // Keep watching the handler if it is still in use.
+        if (pHandler != m_pDefaultHandler && m_hosts.key(pHandler).isNull()) {
+            disconnect(pHandler, 0, this, 0);
+        }
+    }
+    return *this;
+}
+
+HttpVirtualHostRouter& HttpVirtualHostRouter::unmap(HttpRequestHandler *pHandler)
+{
+    Q_ASSERT(pHandler != nullptr);
+
+    QMutexLocker locker(&m_mutex);
+    if (pHandler != nullptr) {
+        unmapUnsafe(pHandler);
+    }
+    return *this;
+}
+
+HttpRequestHandler* HttpVirtualHostRouter::handler(const QString &host)
+{
+    QString key = normalizeHost(host);
+
+    QMutexLocker locker(&m_mutex);
+    return m_hosts.value(key, nullptr);
+}
+
+HttpRequestHandler* HttpVirtualHostRouter::defaultHandler()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pDefaultHandler;
+}
+
+void HttpVirtualHostRouter::setDefaultHandler(HttpRequestHandler *pHandler)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_pDefaultHandler != nullptr && m_hosts.key(m_pDefaultHandler).isNull()) {
+        disconnect(m_pDefaultHandler, 0, this, 0);
+    }
+    m_pDefaultHandler = pHandler;
+    if (pHandler != nullptr) {
+        disconnect(pHandler, 0, this, 0);
+        connect(pHandler, SIGNAL(destroyed(QObject*)), this, SLOT(onHandlerDeleted(QObject*)));
+    }
+}
+
+void HttpVirtualHostRouter::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    foreach (HttpRequestHandler *pHandler, m_hosts.values()) {
+        if (pHandler != m_pDefaultHandler) {
+            disconnect(pHandler, 0, this, 0);
+        }
+    }
+    m_hosts.clear();
+    m_wildcardCount = 0;
+}
+
+void HttpVirtualHostRouter::handleRequest(const HttpRequest &request, HttpResponse &response)
+{
+    HttpRequestHandler *pHandler = findRequestHandler(request);
+    if (pHandler == nullptr) {
+        response.setStatus(HttpResponse::NotFound);
+        response.finalize();
+        return;
+    }
+
+    // Handler is executed in the client's handler thread.
+    pHandler->handleRequest(request, response);
+}
+
+bool HttpVirtualHostRouter::handleRequestHeaders(HttpRequest &request, HttpResponse &response)
+{
+    HttpRequestHandler *pHandler = findRequestHandler(request);
+    if (pHandler == nullptr) {
+        return true;
+    }
+
+    return pHandler->handleRequestHeaders(request, response);
+}
+
+QString HttpVirtualHostRouter::normalizeHost(const QString &host)
+{
+    QString name = host.trimmed().toLower();
+
+    if (name.startsWith('[')) {
+        // IPv6 literal, e.g. [::1]:8000
+        int pos = name.indexOf(']');
+        return pos > 0 ? name.left(pos + 1) : name;
+    }
+
+    // Strip port number
+    int pos = name.lastIndexOf(':');
+    if (pos >= 0) {
+        name.truncate(pos);
+    }
+
+    // Fully qualified name may end with a dot
+    if (name.endsWith('.')) {
+        name.chop(1);
+    }
+
+    // Wildcard "*.example.com" is stored as ".example.com"
+    if (name.startsWith("*.")) {
+        name.remove(0, 1);
+    }
+
+    return name;
+}
+
+void HttpVirtualHostRouter::onHandlerDeleted(QObject *pObject)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // The object is being destroyed, so only pointer comparison is valid here.
+    HttpRequestHandler *pHandler = static_cast<HttpRequestHandler*>(pObject);
+    unmapUnsafe(pHandler);
+    if (m_pDefaultHandler == pHandler) {
+        m_pDefaultHandler = nullptr;
+    }
+}
+
+void HttpVirtualHostRouter::unmapUnsafe(HttpRequestHandler *pHandler)
+{
+    Q_ASSERT(pHandler != nullptr);
+
+    QMutableHashIterator<QString, HttpRequestHandler*> it(m_hosts);
+    while (it.hasNext()) {
+        it.next();
+        if (it.value() == pHandler) {
+            if (it.key().startsWith('.')) {
+                m_wildcardCount--;
+            }
+            it.remove();
+        }
+    }
+
+    if (pHandler != m_pDefaultHandler) {
+        disconnect(pHandler, 0, this, 0);
+    }
+}
+
+HttpRequestHandler* HttpVirtualHostRouter::findRequestHandler(const HttpRequest &request)
+{
+    QString host = normalizeHost(request.option(HttpOption::Host).toString());
+
+    QMutexLocker locker(&m_mutex);
+
+    if (m_hosts.isEmpty() || host.isEmpty()) {
+        return m_pDefaultHandler;
+    }
+
+    HttpRequestHandler *pHandler = m_hosts.value(host, nullptr);
+    if (pHandler != nullptr) {
+        return pHandler;
+    }
+
+    if (m_wildcardCount > 0) {
+        // Probe parent domains:
+        // a.b.example.com -> .b.example.com -> .example.com -> .com
+        int pos = host.indexOf('.', 1);
+        while (pos > 0) {
+            pHandler = m_hosts.value(host.mid(pos), nullptr);
+            if (pHandler != nullptr) {
+                return pHandler;
+            }
+            pos = host.indexOf('.', pos + 1);
+        }
+    }
+
+    // No host matched.
+    return m_pDefaultHandler;
+}
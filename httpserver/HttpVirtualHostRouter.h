@@ -0,0 +1,97 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#ifndef HTTPVIRTUALHOSTROUTER_H
+#define HTTPVIRTUALHOSTROUTER_H
+
+#include <QHash>
+#include <QMutex>
+#include "HttpServerApi.h"
+#include "HttpRequestHandler.h"
+
+/**
+ * Dispatches requests to per-host handlers based on
+ * the Host header (name-based virtual hosting).
+ *
+ * Host names are matched case-insensitively with the port
+ * stripped. A host name may be given as "*.example.com" to
+ * match any subdomain of example.com (but not example.com
+ * itself). Exact host names are resolved with a single hash
+ * lookup; wildcards are only probed when at least one is mapped.
+ * Requests for unknown hosts go to the default handler.
+ */
+class HTTP_API HttpVirtualHostRouter : public HttpRequestHandler
+{
+    Q_OBJECT
+public:
+
+    explicit HttpVirtualHostRouter(HttpRequestHandler *pDefaultHandler = nullptr,
+                                   QObject *pParent = nullptr);
+    ~HttpVirtualHostRouter();
+
+    HttpVirtualHostRouter& map(const QString &host, HttpRequestHandler *pHandler);
+    HttpVirtualHostRouter& unmap(const QString &host);
+    HttpVirtualHostRouter& unmap(HttpRequestHandler *pHandler);
+
+    /**
+     * Returns handler mapped to the host name (exact match only).
+     * @param host Host name, possibly a wildcard.
+     * @return Mapped handler or nullptr.
+     */
+    HttpRequestHandler* handler(const QString &host);
+
+    HttpRequestHandler* defaultHandler();
+    void setDefaultHandler(HttpRequestHandler *pHandler);
+
+    /**
+     * Remove all host mappings.
+     * The default handler is kept.
+     */
+    void clear();
+
+    void handleRequest(const HttpRequest &request, HttpResponse &response);
+    bool handleRequestHeaders(HttpRequest &request, HttpResponse &response);
+
+    /**
+     * Normalize a host name (or Host header value):
+     * lower-case it, drop the port and the trailing dot.
+     * Wildcard "*.example.com" is turned into ".example.com" key.
+     * @param host
+     * @return
+     */
+    static QString normalizeHost(const QString &host);
+
+private slots:
+
+    void onHandlerDeleted(QObject *pObject);
+
+private:
+
+    void unmapUnsafe(HttpRequestHandler *pHandler);
+    HttpRequestHandler* findRequestHandler(const HttpRequest &request);
+
+    QMutex m_mutex; ///< Protective mutex.
+
+    /// Normalized host name to handler map.
+    QHash<QString, HttpRequestHandler*> m_hosts;
+    /// Number of wildcard entries in m_hosts.
+    int m_wildcardCount;
+    /// Handler for requests that match no host.
+    HttpRequestHandler *m_pDefaultHandler;
+};
+
+#endif // HTTPVIRTUALHOSTROUTER_H
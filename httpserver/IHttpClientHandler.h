@@ -20,6 +20,9 @@
 
 #include "HttpServerApi.h"
 
+class HttpDeferredResponse;
+class HttpExchange;
+
 /**
  * Interface to HTTP client handler.
  * This interface is used as a 'call-back' for HTTP responses
@@ -32,6 +35,19 @@ public:
 
     virtual void finalizeResponse() = 0;
 
+    /**
+     * Turn the response being processed into a deferred one.
+     * @return Completion token of the response.
+     */
+    virtual HttpDeferredResponse deferResponse() = 0;
+
+    /**
+     * Move the request and the response being processed
+     * out of the client handler, deferring the response.
+     * @return Exchange handle.
+     */
+    virtual HttpExchange takeExchange() = 0;
+
     virtual ~IHttpClientHandler() {}
 };
 
@@ -24,6 +24,9 @@ CONFIG += dll
 TARGET = httpserver
 DEFINES += HTTPSERVERLIB_BUILD
 
+# zlib is used to decompress request bodies
+LIBS += -lz
+
 SOURCES += \
     HttpServer.cpp \
     HttpClientHandler.cpp \
@@ -34,7 +37,30 @@ SOURCES += \
     HttpRequestHandler.cpp \
     HttpRequestRouter.cpp \
     HttpFileRequestHandler.cpp \
-    HttpResponse.cpp
+    HttpResponse.cpp \
+    HttpVirtualHostRouter.cpp \
+    HttpMiddleware.cpp \
+    HttpServerConfig.cpp \
+    HttpRouteOptions.cpp \
+    HttpDeferredResponse.cpp \
+    HttpRequestBody.cpp \
+    HttpChunkedDecoder.cpp \
+    HttpMultipartParser.cpp \
+    HttpInflater.cpp \
+    HttpArguments.cpp \
+    HttpHeaders.cpp \
+    HttpFieldTable.cpp \
+    HttpArena.cpp \
+    HttpExchange.cpp \
+    HttpConnectionRegistry.cpp \
+    HttpTimingWheel.cpp \
+    HttpConnectionLimiter.cpp \
+    HttpLoadShedder.cpp \
+    HttpCpuTopology.cpp \
+    HttpExecutor.cpp \
+    HttpBulkhead.cpp \
+    HttpScheduler.cpp \
+    HttpCancellationToken.cpp
 
 HEADERS += \
     HttpServerApi.h \
@@ -48,4 +74,29 @@ HEADERS += \
     HttpRequestHandler.h \
     HttpRequestRouter.h \
     HttpFileRequestHandler.h \
+    HttpFunction.h \
+    HttpVirtualHostRouter.h \
+    HttpMiddleware.h \
+    HttpServerConfig.h \
+    HttpRouteOptions.h \
+    HttpDeferredResponse.h \
+    HttpRequestBody.h \
+    HttpChunkedDecoder.h \
+    HttpMultipartParser.h \
+    HttpInflater.h \
+    HttpArguments.h \
+    HttpHeaders.h \
+    HttpFieldTable.h \
+    HttpArena.h \
+    HttpExchange.h \
+    HttpConnectionRegistry.h \
+    HttpTimingWheel.h \
+    HttpConnectionLimiter.h \
+    HttpLoadShedder.h \
+    HttpCpuTopology.h \
+    HttpExecutor.h \
+    HttpBulkhead.h \
+    HttpScheduler.h \
+    HttpCancellationToken.h \
+    HttpTask.h \
     IHttpClientHandler.h
@@ -17,4 +17,6 @@
 TEMPLATE = subdirs
 
 SUBDIRS = httpserver\
-          test
+          test\
+          tests\
+          bench
@@ -0,0 +1,314 @@
+/*
+                          qhttpserver
+
+    Copyright (C) 2015 Arthur Benilov,
+    arthur.benilov@gmail.com
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+    Lesser General Public License for more details.
+*/
+
+#include <QtTest>
+#include "HttpServer.h"
+#include "HttpRequestRouter.h"
+#include "HttpArena.h"
+#include "HttpScheduler.h"
+
+/*
+ * Heap allocations of request parsing across keep-alive requests.
+ *
+ * Parsed headers, arguments and cookies live in arenas which are
+ * rewound, not freed, between the requests of a connection. Once
+ * the arenas have grown to fit the requests, serving more of them
+ * on the same connection must not allocate arena memory anymore.
+ */
+
+namespace {
+
+const int cTimeout = 5000;          ///< Response timeout, ms.
+const int cWarmUpRequests = 4;      ///< Requests letting the arenas grow.
+const int cRequests = 100;          ///< Requests that must not allocate.
+
+} // anonymous namespace
+
+class TestAllocations : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    TestAllocations()
+        : QObject(),
+          m_pServer(nullptr),
+          m_pSocket(nullptr),
+          m_received()
+    {
+    }
+
+private slots:
+
+    void initTestCase();
+    void cleanupTestCase();
+
+    void keepAlive();
+    void overflow();
+
+private:
+
+    bool exchange(int index);
+    bool readResponse();
+
+    HttpServer *m_pServer;
+    QTcpSocket *m_pSocket;
+    QByteArray m_received;  ///< Response data received so far.
+};
+
+void TestAllocations::initTestCase()
+{
+    m_pServer = new HttpServer(QHostAddress::LocalHost, 0);
+    m_pServer->requestRouter()->map(QRegExp("^/echo"), [](const HttpRequest &request, HttpResponse &response) {
+        response.setStatus(HttpResponse::Ok);
+        response.setData((request.argument("name") + request.cookie("session")).toUtf8());
+        response.finalize();
+    });
+    m_pServer->start();
+    QVERIFY(m_pServer->isListening());
+
+    m_pSocket = new QTcpSocket();
+    m_pSocket->connectToHost(QHostAddress::LocalHost, m_pServer->serverPort());
+    QVERIFY(m_pSocket->waitForConnected(cTimeout));
+}
+
+void TestAllocations::cleanupTestCase()
+{
+    delete m_pSocket;
+    delete m_pServer;
+}
+
+void TestAllocations::keepAlive()
+{
+    for (int i = 0; i < cWarmUpRequests; ++i) {
+        QVERIFY(exchange(i));
+    }
+
+    const quint64 allocations = HttpArena::totalHeapAllocations();
+    for (int i = 0; i < cRequests; ++i) {
+        QVERIFY(exchange(i));
+    }
+
+    QCOMPARE(HttpArena::totalHeapAllocations(), allocations);
+}
+
+void TestAllocations::overflow()
+{
+    // Running out of arena space fails the allocation, not the process.
+    HttpArena arena;
+    QCOMPARE(arena.allocate(HttpArena::MaxCapacity + 1), -1);
+    QVERIFY(arena.hasFailed());
+    QCOMPARE(arena.size(), 0);
+
+    arena.reset();
+    QVERIFY(!arena.hasFailed());
+    QCOMPARE(arena.append("name", 4), 0);
+}
+
+bool TestAllocations::exchange(int index)
+{
+    // Same request shape every time, only the values change.
+    QByteArray request = QString("GET /echo?name=user%1&page=%1&sort=asc HTTP/1.1\r\n"
+                                 "Host: localhost\r\n"
+                                 "User-Agent: testallocations\r\n"
+                                 "Accept: text/plain\r\n"
+                                 "Cookie: session=%1; theme=dark\r\n"
+                                 "\r\n")
+            .arg(index % 10)
+            .toLatin1();
+    m_pSocket->write(request);
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!readResponse()) {
+        if (timer.elapsed() > cTimeout || m_pSocket->state() != QAbstractSocket::ConnectedState) {
+            return false;
+        }
+        QTest::qWait(1);
+    }
+    return true;
+}
+
+bool TestAllocations::readResponse()
+{
+    m_received.append(m_pSocket->readAll());
+
+    int headerEnd = m_received.indexOf("\n\n");
+    if (headerEnd < 0) {
+        return false;
+    }
+
+    int contentLength = 0;
+    foreach (const QByteArray &line, m_received.left(headerEnd).split('\n')) {
+        if (line.toLower().startsWith("content-length:")) {
+            contentLength = line.mid(line.indexOf(':') + 1).trimmed().toInt();
+        }
+    }
+
+    int responseSize = headerEnd + 2 + contentLength;
+    if (m_received.size() < responseSize) {
+        return false;
+    }
+
+    m_received.remove(0, responseSize);
+    return true;
+}
+
+/*
+ * Priority scheduling of requests.
+ *
+ * Requests of connections served by the same thread are dispatched
+ * by priority class. With a thread pool each connection has a thread
+ * of its own: there is nothing to order, but requests of all classes
+ * are still served and accounted for.
+ */
+
+class TestScheduling : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    TestScheduling()
+        : QObject(),
+          m_order()
+    {
+    }
+
+private slots:
+
+    void ordering();
+    void threadPool();
+
+private:
+
+    void mapRoutes(HttpServer *pServer, bool record);
+    static bool waitFor(const QList<QTcpSocket*> &sockets);
+
+    QStringList m_order;    ///< Paths in order of dispatch.
+};
+
+void TestScheduling::ordering()
+{
+    HttpServer server(QHostAddress::LocalHost, 0);
+    mapRoutes(&server, true);
+    server.start();
+    QVERIFY(server.isListening());
+
+    // Queue everything before the server gets to read it,
+    // the high priority request last.
+    const int lowCount = 8;
+    QList<QTcpSocket*> sockets;
+    for (int i = 0; i <= lowCount; ++i) {
+        QTcpSocket *pSocket = new QTcpSocket(this);
+        pSocket->connectToHost(QHostAddress::LocalHost, server.serverPort());
+        QVERIFY(pSocket->waitForConnected(cTimeout));
+        sockets.append(pSocket);
+    }
+    for (int i = 0; i <= lowCount; ++i) {
+        QByteArray path = i < lowCount ? "/low" : "/high";
+        sockets.at(i)->write("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        QVERIFY(sockets.at(i)->waitForBytesWritten(cTimeout));
+    }
+
+    QVERIFY(waitFor(sockets));
+    QCOMPARE(m_order.count(), lowCount + 1);
+    QVERIFY(m_order.indexOf("/high") < lowCount);
+    qDeleteAll(sockets);
+}
+
+void TestScheduling::threadPool()
+{
+    HttpServer server(QHostAddress::LocalHost, 0);
+    server.config().setMaxThreads(4);
+    mapRoutes(&server, false);
+    server.start();
+    QVERIFY(server.isListening());
+
+    HttpScheduler::Statistics low = HttpScheduler::statistics(HttpRequest::Priority_Low);
+    HttpScheduler::Statistics high = HttpScheduler::statistics(HttpRequest::Priority_High);
+
+    QList<QTcpSocket*> sockets;
+    for (int i = 0; i < 4; ++i) {
+        QTcpSocket *pSocket = new QTcpSocket(this);
+        pSocket->connectToHost(QHostAddress::LocalHost, server.serverPort());
+        QVERIFY(pSocket->waitForConnected(cTimeout));
+        QByteArray path = i % 2 == 0 ? "/low" : "/high";
+        pSocket->write("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        sockets.append(pSocket);
+    }
+
+    QVERIFY(waitFor(sockets));
+    QCOMPARE(HttpScheduler::statistics(HttpRequest::Priority_Low).count, low.count + 2);
+    QCOMPARE(HttpScheduler::statistics(HttpRequest::Priority_High).count, high.count + 2);
+    qDeleteAll(sockets);
+}
+
+void TestScheduling::mapRoutes(HttpServer *pServer, bool record)
+{
+    QStringList *pOrder = record ? &m_order : nullptr;
+    m_order.clear();
+
+    HttpRequestFunction handler = [pOrder](const HttpRequest &request, HttpResponse &response) {
+        if (pOrder != nullptr) {
+            pOrder->append(request.uri());
+        }
+        response.setStatus(HttpResponse::Ok);
+        response.finalize();
+    };
+    pServer->requestRouter()->map(QRegExp("^/low"), handler,
+                                  HttpRouteOptions().setPriority(HttpRequest::Priority_Low));
+    pServer->requestRouter()->map(QRegExp("^/high"), handler,
+                                  HttpRouteOptions().setPriority(HttpRequest::Priority_High));
+}
+
+bool TestScheduling::waitFor(const QList<QTcpSocket*> &sockets)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (;;) {
+        bool answered = true;
+        foreach (QTcpSocket *pSocket, sockets) {
+            answered = answered && pSocket->bytesAvailable() > 0;
+        }
+        if (answered) {
+            return true;
+        }
+        if (timer.elapsed() > cTimeout) {
+            return false;
+        }
+        QTest::qWait(1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int status = 0;
+    {
+        TestAllocations test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        TestScheduling test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    return status;
+}
+
+#include "main.moc"